@@ -0,0 +1,120 @@
+#ifndef ARENA_C
+#define ARENA_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Tamaño por defecto de cada bloque de un arena
+#define ARENA_BLOCK_SIZE (1 << 20)
+
+// Alineamiento de todas las reservas de un arena
+#define ARENA_ALIGN 16
+
+typedef struct arenablock ArenaBlock;
+typedef struct arena Arena;
+
+// Estructura que representa un bloque de memoria de un arena
+struct arenablock {
+    ArenaBlock* next;
+    size_t size;
+    size_t used;
+    _Alignas(ARENA_ALIGN) char data[];
+};
+
+// Estructura que representa un arena: reserva memoria avanzando un puntero dentro de bloques grandes,
+// y libera todos los bloques de una vez. Si shared es 1 varios hilos pueden reservar a la vez
+struct arena {
+    ArenaBlock* head; // block currently used for allocations
+    size_t block_size;
+    void* last; // last allocation, the only one that can grow in place
+    size_t allocated; // bytes handed out
+    int shared;
+    pthread_mutex_t lock;
+};
+
+// Función que crea un arena con bloques de block_size bytes
+Arena* create_arena(size_t block_size, int shared) {
+    Arena* arena = (Arena*)malloc(sizeof(Arena));
+    arena->head = NULL;
+    arena->block_size = block_size;
+    arena->last = NULL;
+    arena->allocated = 0;
+    arena->shared = shared;
+    pthread_mutex_init(&arena->lock, NULL);
+    return arena;
+}
+
+// Función que redondea size al alineamiento del arena
+size_t arena_round(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+// Función que reserva size bytes sin tomar el lock
+void* arena_alloc_unlocked(Arena* arena, size_t size) {
+    size = arena_round(size);
+    ArenaBlock* block = arena->head;
+    if (block == NULL || block->used + size > block->size) {
+        size_t block_size = size > arena->block_size ? size : arena->block_size;
+        block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + block_size);
+        block->next = arena->head;
+        block->size = block_size;
+        block->used = 0;
+        arena->head = block;
+    }
+    void* ptr = block->data + block->used;
+    block->used += size;
+    arena->last = ptr;
+    arena->allocated += size;
+    return ptr;
+}
+
+// Función que reserva size bytes en el arena
+void* arena_alloc(Arena* arena, size_t size) {
+    if (arena->shared)
+        pthread_mutex_lock(&arena->lock);
+    void* ptr = arena_alloc_unlocked(arena, size);
+    if (arena->shared)
+        pthread_mutex_unlock(&arena->lock);
+    return ptr;
+}
+
+// Función que cambia el tamaño de una reserva de old_size a new_size bytes. Si es la última reserva del arena y cabe en su
+// bloque crece en el mismo lugar; si no, se copia a una reserva nueva y la anterior queda sin uso hasta liberar el arena
+void* arena_realloc(Arena* arena, void* ptr, size_t old_size, size_t new_size) {
+    if (arena->shared)
+        pthread_mutex_lock(&arena->lock);
+
+    void* result;
+    ArenaBlock* block = arena->head;
+    if (ptr != NULL && ptr == arena->last &&
+        (char*)ptr - block->data + arena_round(new_size) <= block->size) {
+        size_t grow = arena_round(new_size) - arena_round(old_size);
+        block->used += grow;
+        arena->allocated += grow;
+        result = ptr;
+    }
+    else {
+        result = arena_alloc_unlocked(arena, new_size);
+        if (ptr != NULL)
+            memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+    }
+
+    if (arena->shared)
+        pthread_mutex_unlock(&arena->lock);
+    return result;
+}
+
+// Función que libera todos los bloques del arena y el arena
+void destroy_arena(Arena* arena) {
+    ArenaBlock* block = arena->head;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    pthread_mutex_destroy(&arena->lock);
+    free(arena);
+}
+
+#endif
@@ -0,0 +1,266 @@
+#ifndef COMPACT_C
+#define COMPACT_C
+
+#include "pager.c"
+
+#define COMPACT_MAGIC "MTREECP1"
+
+typedef struct compactpage CompactPage;
+typedef struct float32point Float32Point;
+typedef struct float32entry Float32Entry;
+typedef struct int16point Int16Point;
+typedef struct int16entry Int16Entry;
+
+// Formas de guardar las coordenadas de una página compacta, siempre relativas al punto de enrutamiento de la página
+typedef enum {
+    COMPACT_FLOAT32, // float de 32 bits
+    COMPACT_INT16 // entero de 16 bits que cuenta pasos de tamaño scale
+} CompactEncoding;
+
+// Estructura del comienzo de cada página compacta, seguida de num_entries entradas del tipo que indican leaf y encoding.
+// Las coordenadas de las entradas son relativas a routing, el punto de la entrada que apunta a la página
+struct compactpage {
+    uint16_t num_entries;
+    uint8_t leaf;
+    uint8_t encoding;
+    uint32_t reserved;
+    double scale;
+    Point routing;
+};
+
+// Estructuras de las entradas de hojas (solo el punto) y de nodos internos (punto, radio redondeado hacia arriba
+// y número de página del hijo) con cada forma de guardar las coordenadas
+struct float32point {
+    float dx, dy;
+};
+
+struct float32entry {
+    float dx, dy;
+    float cr;
+    uint32_t child;
+};
+
+struct int16point {
+    int16_t dx, dy;
+};
+
+struct int16entry {
+    int16_t dx, dy;
+    float cr;
+    uint32_t child;
+};
+
+// Cantidad de bytes de una página compacta para sus entradas
+#define COMPACT_PAGE_SPACE (DISK_PAGE_SIZE - sizeof(CompactPage))
+
+// Mayor cantidad de hijos de una página compacta (nodos internos con coordenadas de 16 bits)
+#define COMPACT_MAX_CHILDREN (COMPACT_PAGE_SPACE / sizeof(Int16Entry))
+
+// Función que retorna el tamaño de las entradas de una página compacta
+size_t compact_entry_size(CompactEncoding encoding, int leaf) {
+    if (encoding == COMPACT_FLOAT32)
+        return leaf ? sizeof(Float32Point) : sizeof(Float32Entry);
+    return leaf ? sizeof(Int16Point) : sizeof(Int16Entry);
+}
+
+// Función que retorna la mayor cantidad de entradas por nodo de un árbol que se guarde con encoding,
+// limitada por los nodos internos, cuyas entradas son más grandes
+int compact_node_capacity(CompactEncoding encoding) {
+    return (int)(COMPACT_PAGE_SPACE / compact_entry_size(encoding, 0));
+}
+
+// Función que redondea r hacia arriba a un float, para que un radio guardado nunca sea menor al que se calculó
+float round_up_float(double r) {
+    float f = (float)r;
+    if ((double)f < r)
+        f = nextafterf(f, INFINITY);
+    return f;
+}
+
+// Función que decodifica la entrada i de una página compacta. El campo child es 0 si la entrada es un punto
+DiskEntry compact_entry(const CompactPage* page, int i) {
+    const char* entries = (const char*)(page + 1);
+    DiskEntry e = {page->routing, 0.0, 0, 0};
+
+    if (page->encoding == COMPACT_FLOAT32) {
+        const Float32Entry* f = (const Float32Entry*)(entries + i * compact_entry_size(COMPACT_FLOAT32, page->leaf));
+        e.p.x += f->dx;
+        e.p.y += f->dy;
+        if (!page->leaf) {
+            e.cr = f->cr;
+            e.child = f->child;
+        }
+    }
+    else {
+        const Int16Entry* q = (const Int16Entry*)(entries + i * compact_entry_size(COMPACT_INT16, page->leaf));
+        e.p.x += q->dx * page->scale;
+        e.p.y += q->dy * page->scale;
+        if (!page->leaf) {
+            e.cr = q->cr;
+            e.child = q->child;
+        }
+    }
+    return e;
+}
+
+// Función que guarda en page el punto de la entrada i, relativo al punto de enrutamiento de la página
+void encode_compact_point(CompactPage* page, int i, Point p) {
+    char* entries = (char*)(page + 1);
+    double dx = p.x - page->routing.x;
+    double dy = p.y - page->routing.y;
+
+    if (page->encoding == COMPACT_FLOAT32) {
+        Float32Entry* f = (Float32Entry*)(entries + i * compact_entry_size(COMPACT_FLOAT32, page->leaf));
+        f->dx = (float)dx;
+        f->dy = (float)dy;
+    }
+    else {
+        Int16Entry* q = (Int16Entry*)(entries + i * compact_entry_size(COMPACT_INT16, page->leaf));
+        q->dx = page->scale > 0.0 ? (int16_t)lround(dx / page->scale) : 0;
+        q->dy = page->scale > 0.0 ? (int16_t)lround(dy / page->scale) : 0;
+    }
+}
+
+// Función que guarda en page el radio y la página del hijo de la entrada interna i
+void encode_compact_child(CompactPage* page, int i, float cr, uint32_t child) {
+    char* entries = (char*)(page + 1);
+    if (page->encoding == COMPACT_FLOAT32) {
+        Float32Entry* f = (Float32Entry*)(entries + i * sizeof(Float32Entry));
+        f->cr = cr;
+        f->child = child;
+    }
+    else {
+        Int16Entry* q = (Int16Entry*)(entries + i * sizeof(Int16Entry));
+        q->cr = cr;
+        q->child = child;
+    }
+}
+
+// Función que escribe node en la página page_id con coordenadas relativas a routing, asignando páginas a sus hijos
+// a partir de *next_page. Los puntos guardados no son exactamente los del árbol, así que cada radio se calcula desde los
+// puntos decodificados de su subárbol y se redondea hacia arriba: la consulta nunca descarta un subárbol que tiene puntos que la cumplen.
+// Guarda en *radius el radio que necesita la entrada que apunta a node. Retorna 0 si tuvo éxito y -1 si no
+int write_compact_page(int fd, Node* node, Point routing, CompactEncoding encoding, uint32_t page_id, uint32_t* next_page, double* radius) {
+    int leaf = is_leaf(node);
+    if (node->num_entries > (int)(COMPACT_PAGE_SPACE / compact_entry_size(encoding, leaf)))
+        return -1;
+
+    char buffer[DISK_PAGE_SIZE];
+    memset(buffer, 0, sizeof(buffer));
+    CompactPage* page = (CompactPage*)buffer;
+    page->num_entries = node->num_entries;
+    page->leaf = leaf;
+    page->encoding = encoding;
+    page->routing = routing;
+
+    // the 16 bit steps are as small as the farthest coordinate allows
+    double max_offset = 0.0;
+    for (int i = 0; i < node->num_entries; i++) {
+        max_offset = fmax(max_offset, fabs(node->entries[i].p.x - routing.x));
+        max_offset = fmax(max_offset, fabs(node->entries[i].p.y - routing.y));
+    }
+    page->scale = max_offset / INT16_MAX;
+
+    uint32_t child_page = *next_page;
+    for (int i = 0; i < node->num_entries; i++) {
+        encode_compact_point(page, i, node->entries[i].p);
+        if (node->entries[i].a != NULL)
+            (*next_page)++; // children of the same node get consecutive pages
+    }
+
+    *radius = 0.0;
+    for (int i = 0; i < node->num_entries; i++) {
+        Node* a = node->entries[i].a;
+        DiskEntry e = compact_entry(page, i);
+        if (a != NULL) {
+            double child_radius;
+            if (write_compact_page(fd, a, e.p, encoding, child_page, next_page, &child_radius) != 0)
+                return -1;
+            float cr = round_up_float(child_radius);
+            encode_compact_child(page, i, cr, child_page++);
+            e.cr = cr;
+        }
+        *radius = fmax(*radius, euclidean_distance(routing, e.p) + e.cr);
+    }
+
+    if (pwrite(fd, buffer, DISK_PAGE_SIZE, (off_t)page_id * DISK_PAGE_SIZE) != DISK_PAGE_SIZE)
+        return -1;
+    return 0;
+}
+
+// Función que guarda el árbol root en el archivo path con páginas compactas, un nodo por página. Las coordenadas de la
+// raíz son relativas al centro de sus puntos. Falla si un nodo tiene más entradas de las que caben en una página
+// (ver compact_node_capacity). Retorna 0 si tuvo éxito y -1 si no
+int write_compact_tree(Node* root, const char* path, CompactEncoding encoding) {
+    Point center = {0.0, 0.0};
+    if (root->num_entries > 0) {
+        Point low = root->entries[0].p;
+        Point high = low;
+        for (int i = 1; i < root->num_entries; i++) {
+            Point p = root->entries[i].p;
+            low.x = fmin(low.x, p.x);
+            low.y = fmin(low.y, p.y);
+            high.x = fmax(high.x, p.x);
+            high.y = fmax(high.y, p.y);
+        }
+        center.x = (low.x + high.x) / 2;
+        center.y = (low.y + high.y) / 2;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+
+    uint32_t next_page = 2; // page 0 is the header and page 1 the root
+    double radius;
+    if (write_compact_page(fd, root, center, encoding, 1, &next_page, &radius) != 0) {
+        close(fd);
+        return -1;
+    }
+    return finish_page_file(fd, COMPACT_MAGIC, next_page, root->num_entries);
+}
+
+// Función que abre un árbol guardado con write_compact_tree, con un cache de cache_pages páginas (al menos 1)
+PagedTree* open_compact_tree(const char* path, int cache_pages) {
+    return open_page_file(path, cache_pages, COMPACT_MAGIC);
+}
+
+// Función que realiza la query Q en el nodo guardado en la página compacta page, guardando los puntos decodificados en sol
+void compact_range_search(PagedTree* tree, uint32_t page, Query Q, PointBuffer* sol, int* disk_accesses) {
+    const CompactPage* node = (const CompactPage*)fetch_page(tree, page, disk_accesses);
+    if (node->num_entries * compact_entry_size(node->encoding, node->leaf) > COMPACT_PAGE_SPACE) {
+        printf("La página %u del árbol tiene %d entradas.\n", page, node->num_entries);
+        exit(1);
+    }
+
+    // Children are copied out before descending, since visiting them may evict this page from the cache
+    uint32_t children[COMPACT_MAX_CHILDREN];
+    int num_children = 0;
+
+    for (int i = 0; i < node->num_entries; i++) {
+        DiskEntry e = compact_entry(node, i);
+        double d = euclidean_distance(e.p, Q.q);
+        if (e.child == 0) {
+            if (d <= Q.r)
+                push_point(sol, e.p);
+        }
+        else if (d <= e.cr + Q.r) {
+            children[num_children++] = e.child;
+        }
+    }
+
+    for (int i = 0; i < num_children; i++)
+        compact_range_search(tree, children[i], Q, sol, disk_accesses);
+}
+
+// Función que busca los puntos en la query Q del árbol compacto tree, guarda cuántos son en result_size y las lecturas de
+// páginas en disk_accesses. Los puntos son los guardados en el archivo, redondeados según su forma de guardar las coordenadas
+Point* compact_search_points_in_radio(PagedTree* tree, Query Q, int* result_size, int* disk_accesses) {
+    PointBuffer sol = {NULL, 0, 0};
+
+    compact_range_search(tree, tree->header.root_page, Q, &sol, disk_accesses);
+    *result_size = sol.size;
+    return sol.points;
+}
+
+#endif
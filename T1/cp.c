@@ -1,4 +1,14 @@
+#ifndef CP_C
+#define CP_C
+
+#include <stdint.h>
+
 #include "mtree.c"
+#include "pointfile.c"
+#include "threadpool.c"
+
+// Cantidad mínima de puntos de un subconjunto Fj para construir su subárbol como tarea aparte en la construcción paralela
+#define CP_TASK_MIN_POINTS 2048
 
 typedef struct subsetstructure SubsetStructure;
 typedef struct pointandnode PointAndNode;
@@ -6,7 +16,7 @@ typedef struct pointandnode PointAndNode;
 // Estructura que representa un punto con un nodo
 struct pointandnode {
     Point p;
-    Node n;
+    Node* n;
     int h;
 };
 
@@ -16,6 +26,7 @@ struct subsetstructure {
     Point* sample_subset;
     int working;
     int subset_size;
+    int subset_capacity;
 };
 
 // Function that delete a point from an array
@@ -25,12 +36,15 @@ void deletePointFromArray(Point** array, int index, int* array_size) {
     }
 
     (*array_size)--;
-    *array = (Point*)realloc(*array, (*array_size) * sizeof(Point));
 }
 
-// Function that adds a point to an array
-void addPointToArray(Point** array, Point point, int* array_size) {
-    *array = (Point*)realloc(*array, (*array_size + 1) * sizeof(Point));
+// Function that adds a point to an array allocated in 'scratch', doubling its capacity when it is full
+void addPointToArray(Arena* scratch, Point** array, Point point, int* array_size, int* array_capacity) {
+    if (*array_size == *array_capacity) {
+        int capacity = *array_capacity == 0 ? 16 : 2 * *array_capacity;
+        *array = (Point*)arena_realloc(scratch, *array, *array_capacity * sizeof(Point), capacity * sizeof(Point));
+        *array_capacity = capacity;
+    }
     (*array)[*array_size] = point;
     (*array_size)++;
 }
@@ -45,8 +59,13 @@ void deletePointInF(Point** F, int* F_size, Point p) {
     }
 }
 
-void addPointAndNode(PointAndNode** array, PointAndNode ps, int* array_size) {
-    *array = (PointAndNode*)realloc(*array, (*array_size + 1) * sizeof(PointAndNode));
+// Function that adds a subtree to an array allocated in 'scratch', doubling its capacity when it is full
+void addPointAndNode(Arena* scratch, PointAndNode** array, PointAndNode ps, int* array_size, int* array_capacity) {
+    if (*array_size == *array_capacity) {
+        int capacity = *array_capacity == 0 ? 16 : 2 * *array_capacity;
+        *array = (PointAndNode*)arena_realloc(scratch, *array, *array_capacity * sizeof(PointAndNode), capacity * sizeof(PointAndNode));
+        *array_capacity = capacity;
+    }
     (*array)[*array_size] = ps;
     (*array_size)++;
 }
@@ -57,31 +76,25 @@ void insertEntry(Node* node, Entry entry) {
     (node->num_entries)++;
 }
 
-// Function that calculates the height of a tree
+// Function that calculates the height of a tree. Every leaf of the trees built by CP, SS and insertion is at the same
+// depth, so it follows the first child of each node instead of walking the whole tree (mtree_stats in stats.c checks it)
 int treeHeight(Node* node) {
-    if (node == NULL) {
-        return 0; // If the tree is empty, height is 0
-    } else {
-        int max_subtree_height = 0;
-        // Iterate through all entries in the node
-        for (int i = 0; i < node->num_entries; i++) {
-            Node* child = node->entries[i].a;
-            int subtree_height = treeHeight(child); // Recursively find height of each child subtree
-            if (subtree_height > max_subtree_height) {
-                max_subtree_height = subtree_height; // Update the maximum subtree height
-            }
-        }
-        return 1 + max_subtree_height; // Height of the current node is 1 plus the maximum height of its child subtrees
+    int height = 0;
+    while (node != NULL) {
+        height++;
+        node = node->num_entries > 0 ? node->entries[0].a : NULL;
     }
+    return height;
 }
 
 // Function that insert a 'Tj' node into the leaf of a 'node', where the leaf point is the same as the point of F[j].
-void joinTj(Node* Tsup,  PointAndNode* Tj, int* already_inserted) {
+// 'levels' is the height of Tsup before joining, so subtrees that were already joined to its leaves are not searched again
+void joinTj(Node* Tsup,  PointAndNode* Tj, int* already_inserted, int levels) {
     Entry *node_entries = Tsup->entries; // entries of the node
     int entries_size = Tsup->num_entries; // size of entries of the node
 
-    // if the node is a leaf
-    if (is_leaf(Tsup)) {
+    // if the node is a leaf of the original Tsup
+    if (levels == 1) {
         Point pj = Tj->p; // corresponding point to p_j in F
 
         // for each entry, verify if his point is equal to p_j
@@ -89,7 +102,7 @@ void joinTj(Node* Tsup,  PointAndNode* Tj, int* already_inserted) {
             Entry* entry = &node_entries[i];
             Point p = entry->p;
             if (p.x == pj.x && p.y == pj.y) { // if the points have the same coordinates, add Tj to that leaf
-                entry->a = &(Tj->n);
+                entry->a = Tj->n;
                 *already_inserted = 1; // Tj was inserted
                 return;
             }
@@ -107,7 +120,7 @@ void joinTj(Node* Tsup,  PointAndNode* Tj, int* already_inserted) {
             else {
                 Entry* entry = &node_entries[i];
                 Node* child = entry->a;
-                joinTj(child, Tj, already_inserted);
+                joinTj(child, Tj, already_inserted, levels - 1);
             }
         }
     }
@@ -123,6 +136,7 @@ void setCoveringRadius(Node *node) {
         // for each entry, set the covering radio as 0.0
         for (int i=0; i < entries_size; i++) {
             node_entries[i].cr = 0.0;
+            node_entries[i].count = 1;
         }
     }
 
@@ -132,27 +146,80 @@ void setCoveringRadius(Node *node) {
             Point p = node_entries[i].p; // point p of the entry
             Node *a = node_entries[i].a; // subtree of the node
 
+            setCoveringRadius(a); // recursion on subtrees first, so their covering radius are already set
+
             Entry* a_entries = a->entries; // entries of the subtree
             int a_size = a->num_entries; // size of the entries of the subtree
 
             double maxDistance = 0; // set the initial max distance as 0
 
-            // for each entry in the subtree, search the max distance between the entry point and the parent point
+            // for each entry in the subtree, search the max distance between the parent point and the ball of the entry
             for (int j=0; j < a_size; j++) {
-                double distance = euclidean_distance(p, a_entries[j].p); // distance between p and the point of the j entry of the subtree
+                a_entries[j].pd = euclidean_distance(p, a_entries[j].p); // distance to the parent point, used to prune searches
+                double distance = a_entries[j].pd + a_entries[j].cr; // distance between p and the farthest point covered by the j entry of the subtree
                 if (distance > maxDistance)
                     maxDistance = distance;
             }
 
             node_entries[i].cr = maxDistance; // set the covering radius for the entry
+            node_entries[i].count = subtree_count(a); // points below the entry, for range_count
+        }
+    }
+}
+
+
+// Function that derives the seed of the j-th recursive call from the seed of its parent call
+unsigned int deriveSeed(unsigned int seed, int j) {
+    uint64_t z = ((uint64_t)seed << 32 | (uint32_t)j) + 0x9E3779B97F4A7C15ULL; // splitmix64 finalizer
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned int)((z ^ (z >> 31)) >> 32);
+}
 
-            setCoveringRadius(a); // recursion on subtrees
+// Function that adds to T_prime the subtrees of 'node' (of height node_height) that have height h, and their root points to F
+void addSubtreesOfHeight(Arena* scratch, Node* node, int node_height, int h, PointAndNode** T_prime, int* T_prime_size, int* T_prime_capacity,
+                         Point** F, int* F_size, int* F_capacity) {
+    for (int p=0; p < node->num_entries; p++) {
+        Entry entry = node->entries[p]; // entry of the node
+        Node *subtree = entry.a; // subtree of the entry
+
+        // the tree is balanced, so every subtree one level below has height node_height - 1
+        if (node_height - 1 == h) {
+            PointAndNode ps = {entry.p, subtree, h};
+            addPointAndNode(scratch, T_prime, ps, T_prime_size, T_prime_capacity); // add this node to T_prime
+            addPointToArray(scratch, F, entry.p, F_size, F_capacity); // add the root point to F
+        }
+        else {
+            addSubtreesOfHeight(scratch, subtree, node_height - 1, h, T_prime, T_prime_size, T_prime_capacity, F, F_size, F_capacity);
         }
     }
 }
 
+typedef struct {
+    Point* P;
+    int P_size;
+    unsigned int seed;
+    TaskScheduler* scheduler;
+    Node* result;
+} CPTask;
+
+Node* cpBuild(Point* P, int P_size, unsigned int seed, TaskScheduler* scheduler);
+
+// Function that builds the subtree of a CPTask, used both inline and as a scheduler task
+void cpTask(void* arg) {
+    CPTask* task = (CPTask*)arg;
+    task->result = cpBuild(task->P, task->P_size, task->seed, task->scheduler);
+}
+
+// Function that builds the tree of the points of 'source' with the CP algorithm. Random choices use only 'seed', and recursive calls get seeds derived from it,
+// so the tree is the same whether 'scheduler' is NULL (sequential) or the subtrees of step 6 are built as parallel tasks.
+// The points of 'source' are only read in steps 1 to 3, in order except for the samples, so it can be a file read by chunks.
+// The nodes come from create_node; every temporary array of the call lives in its own scratch arena, freed before returning
+Node* cpBuildFromSource(PointSource* source, unsigned int seed, TaskScheduler* scheduler) {
+    int P_size = source->size;
+    const Point* P;
+    int chunk_size;
 
-Node* ciacciaPatella(Point* P, int P_size) {
     // STEP 1
 
     // If the number of points in the point set is less or equal to B.
@@ -161,25 +228,33 @@ Node* ciacciaPatella(Point* P, int P_size) {
         Node* newNode = create_node();
 
         // For each point in the point set:
-        for (int i=0; i<P_size; i++) {
-            // Create a new Entry structure with the format on a leaf 
-            Entry newEntry = {P[i], 0.0, NULL};
-    
-            // Add the Entry structure into the 'entries' array of the created node
-            insertEntry(newNode, newEntry);
+        for (int first = 0; first < P_size; first += chunk_size) {
+            P = point_source_chunk(source, first, &chunk_size);
+            for (int i=0; i<chunk_size; i++) {
+                // Create a new Entry structure with the format on a leaf 
+                Entry newEntry = {P[i], 0.0, NULL, 0.0, 1};
+        
+                // Add the Entry structure into the 'entries' array of the created node
+                insertEntry(newNode, newEntry);
+            }
         }
 
         return newNode;
     }
 
     
-    int K = intMin(B, (int)ceil(P_size/B)); // Define the sample size (K)
+    int K = intMin(B, (int)ceil((double)P_size / B)); // Define the sample size (K)
     int F_size;
+    int F_capacity = K;
+
+    // the subsets take about P_size points, and doubling their capacity at most doubles that
+    Arena* scratch = create_arena(2 * P_size * sizeof(Point) + K * sizeof(SubsetStructure), 0);
 
     Point *F; // array F containing samples chosen at random from P
-    F = (Point*)malloc(K * sizeof(Point));
-    SubsetStructure *samples_subsets = (SubsetStructure*)malloc(K * sizeof(SubsetStructure)); // array that contains, for each element, the Fk array and its size
-    int *used_indices = (int*)malloc(P_size * sizeof(int)); // array that indicates wich indices are already selected from P to make the sample F
+    F = (Point*)arena_alloc(scratch, K * sizeof(Point));
+    SubsetStructure *samples_subsets = (SubsetStructure*)arena_alloc(scratch, K * sizeof(SubsetStructure)); // array that contains, for each element, the Fk array and its size
+    int *used_indices = (int*)arena_alloc(scratch, P_size * sizeof(int)); // array that indicates wich indices are already selected from P to make the sample F
+    int *nearest_sample = (int*)arena_alloc(scratch, P_size * sizeof(int)); // index of the nearest sample of each point of P
 
     do {
 
@@ -192,9 +267,9 @@ Node* ciacciaPatella(Point* P, int P_size) {
 
         for (int i = 0; i < K; i++){
             while (1) {
-                int j = rand() % P_size;
+                int j = rand_r(&seed) % P_size;
                 if (used_indices[j] == 0){
-                    F[i] = P[j];
+                    F[i] = point_source_get(source, j);
                     used_indices[j] = 1;
                     break;
                 }
@@ -205,7 +280,7 @@ Node* ciacciaPatella(Point* P, int P_size) {
 
         // Initialize every sample subset structure belonging to the sample points in F and add to samples subsets array
         for (int i=0; i<K; i++) {
-            SubsetStructure newSubsetStructure = {F[i], NULL, 0, 1};
+            SubsetStructure newSubsetStructure = {F[i], NULL, 1, 0, 0};
             samples_subsets[i] = newSubsetStructure;
         }
 
@@ -213,23 +288,29 @@ Node* ciacciaPatella(Point* P, int P_size) {
         // STEP 3
 
         // For each point in the point set, assign to the nearest sample
-        for (int i=0; i<P_size; i++) {
-            Point p = P[i]; // get the point P[i]
-
-            double nearest_distance = euclidean_distance(p, F[0]);
-            int nearest_sample_index = 0;
-
-            // evaluate for each sample point in F
-            for (int j=1; j<K; j++) {
-                double distance = euclidean_distance(p, F[j]);
-                if (distance < nearest_distance) {
-                    nearest_distance = distance;
-                    nearest_sample_index = j;
-                }
+        for (int first = 0; first < P_size; first += chunk_size) {
+            P = point_source_chunk(source, first, &chunk_size);
+            for (int i=0; i<chunk_size; i++) {
+                double nearest_distance; // squared distance to the nearest sample
+
+                // evaluate every sample point in F at once
+                int nearest_sample_index = nearest_point(&P[i].x, &F[0].x, POINT_STRIDE, K, &nearest_distance);
+
+                nearest_sample[first + i] = nearest_sample_index;
+                samples_subsets[nearest_sample_index].subset_capacity++;
             }
+        }
 
-            // Add the point of P to the subset of the nearest sample
-            addPointToArray(&(samples_subsets[nearest_sample_index].sample_subset), p, &(samples_subsets[nearest_sample_index].subset_size)); // add P[i] to Fj
+        // Every Fj gets exactly the space of its points, then the points of P are added to the subset of their nearest sample
+        for (int j=0; j<K; j++) {
+            samples_subsets[j].sample_subset = (Point*)arena_alloc(scratch, samples_subsets[j].subset_capacity * sizeof(Point));
+        }
+        for (int first = 0; first < P_size; first += chunk_size) {
+            P = point_source_chunk(source, first, &chunk_size);
+            for (int i=0; i<chunk_size; i++) {
+                SubsetStructure* Fj = &samples_subsets[nearest_sample[first + i]];
+                Fj->sample_subset[Fj->subset_size++] = P[i]; // add P[i] to Fj
+            }
         }
 
 
@@ -257,7 +338,7 @@ Node* ciacciaPatella(Point* P, int P_size) {
                         if (samples_subsets[l].working == 0)
                             continue;
 
-                        double distance = euclidean_distance(p, samples_subsets[l].point);
+                        double distance = squared_distance(p, samples_subsets[l].point);
                         if (distance < nearest_distance) {
                             nearest_distance = distance;
                             nearest_sample_index = l;
@@ -265,36 +346,49 @@ Node* ciacciaPatella(Point* P, int P_size) {
                     }
 
                     // Move the point from Fj point to the nearest subset (F_l)
-                    addPointToArray(&(samples_subsets[nearest_sample_index].sample_subset), p, &(samples_subsets[nearest_sample_index].subset_size));
+                    SubsetStructure* Fl = &samples_subsets[nearest_sample_index];
+                    addPointToArray(scratch, &(Fl->sample_subset), p, &(Fl->subset_size), &(Fl->subset_capacity));
                 }
-
-                // Free memory from the sample array Fj being redistributed
-                free(samples_subsets[j].sample_subset);
             }
         }
-
-        if (F_size == 1) {
-            free(F);
-            F = (Point*)malloc(K * sizeof(Point));
-        }
         
     } while (F_size == 1); // STEP 5: if the sample size |F| = 1, return to step 2
 
-    free(used_indices);
-
     // STEP 6
 
+    // Recursively call cpBuild for each subset Fj. The subsets are independent, so large ones are built as parallel tasks when there is a scheduler
+    CPTask* tasks = (CPTask*)arena_alloc(scratch, K * sizeof(CPTask));
+    atomic_int pending;
+    atomic_init(&pending, 0);
+
+    for (int j = 0; j < K; j++) {
+
+        // if this Fj array was redistributed, continue to the next iteration
+        if (samples_subsets[j].working == 0)
+            continue;
+
+        CPTask task = {samples_subsets[j].sample_subset, samples_subsets[j].subset_size, deriveSeed(seed, j), scheduler, NULL};
+        tasks[j] = task;
+
+        if (scheduler != NULL && task.P_size >= CP_TASK_MIN_POINTS)
+            spawn_task(scheduler, cpTask, &tasks[j], &pending);
+        else
+            cpTask(&tasks[j]);
+    }
+
+    if (scheduler != NULL)
+        wait_tasks(scheduler, &pending);
+
     PointAndNode* T = NULL; // array where we will save every Tj obtained from F
     int T_size = 0;
+    int T_capacity = 0;
 
     for (int j = 0; j < K; j++) {
 
-        // if this Fj array was redistributed, continue to the next iteration
         if (samples_subsets[j].working == 0)
             continue;
 
-        // Recursively call ciacciaPatella for each subset Fj
-        Node* Tj = ciacciaPatella(samples_subsets[j].sample_subset, samples_subsets[j].subset_size);
+        Node* Tj = tasks[j].result;
 
 
         // STEP 7
@@ -311,32 +405,28 @@ Node* ciacciaPatella(Point* P, int P_size) {
 
                 // add his subtrees to the T array
                 Entry Tj_entry = Tj_entries[p];
-                PointAndNode ps = {Tj_entry.p, *(Tj_entry.a), 0};
-                addPointAndNode(&T, ps, &T_size);
+                PointAndNode ps = {Tj_entry.p, Tj_entry.a, 0};
+                addPointAndNode(scratch, &T, ps, &T_size, &T_capacity);
 
                 // the relevant point is added to F
-                addPointToArray(&F, Tj_entry.p, &F_size); // add the point to F
+                addPointToArray(scratch, &F, Tj_entry.p, &F_size, &F_capacity); // add the point to F
             }
         }
 
         // if root size is greater than or equal to b: Add Tj to the node array T
         else {
-            PointAndNode ps = {samples_subsets[j].point, *Tj, 0};
-            addPointAndNode(&T, ps, &T_size);
+            PointAndNode ps = {samples_subsets[j].point, Tj, 0};
+            addPointAndNode(scratch, &T, ps, &T_size, &T_capacity);
         }
-
-        free(samples_subsets[j].sample_subset);
     }
 
-    free(samples_subsets);
-
     // STEP 8
 
     // found h
     int h = INT_MAX;
 
     for (int j=0; j < T_size; j++) {
-        Node *Tj = &(T[j].n);
+        Node *Tj = T[j].n;
 
         // if another Tj has smaller height, set that height on h
         int subtree_height = treeHeight(Tj);
@@ -349,59 +439,46 @@ Node* ciacciaPatella(Point* P, int P_size) {
     // Define T' as empty set
     PointAndNode *T_prime = NULL;
     int T_prime_size = 0;
+    int T_prime_capacity = 0;
 
     // STEP 9
 
     // for each Tj 
     for (int j=0; j < T_size; j++) {
-        Node Tj = T[j].n; // Tj
+        Node *Tj = T[j].n; // Tj
         int Tj_height = T[j].h; // Hieght of Tj
 
         // if the Tj height is equal to h, add the Tj to T_prime
         if (Tj_height == h)
-            addPointAndNode(&T_prime, T[j], &T_prime_size);
+            addPointAndNode(scratch, &T_prime, T[j], &T_prime_size, &T_prime_capacity);
 
         else {
             // delete the respective point j in F
             deletePointInF(&F, &F_size, T[j].p);
 
-            Entry* Tj_entries = Tj.entries;
-            int Tj_size = Tj.num_entries;
-
-            // for each subtree in Tj, insert into T_prime if the subtree has height equal to h
-            for (int p=0; p < Tj_size; p++) {
-                Entry Tj_entry = Tj_entries[p]; // entry of Tj
-                Node *subtree = Tj_entry.a; // subtree of Tj
-                int subtree_height = treeHeight(subtree); // subtree height
-
-                // if the subtree height is equal to h:
-                if (subtree_height == h) {
-                    Point root_point = Tj_entry.p; // root point of the subtree of height h
-                    PointAndNode ps = {root_point, *subtree, subtree_height};
-                    addPointAndNode(&T_prime, ps, &T_prime_size); // add this node to T_prime
-                    addPointToArray(&F, root_point, &F_size); // add the root point to F
-                }
-            }
+            // insert into T_prime every subtree of Tj with height equal to h
+            addSubtreesOfHeight(scratch, Tj, Tj_height, h, &T_prime, &T_prime_size, &T_prime_capacity, &F, &F_size, &F_capacity);
         }
     }
 
     // STEP 10
-    Node *T_sup = ciacciaPatella(F, F_size); // apply cp algorithm to F (sample array)
+    Node *T_sup = cpBuild(F, F_size, deriveSeed(seed, K), scheduler); // apply cp algorithm to F (sample array)
 
 
     //STEP 11
     
     int Tj_inserted; // variable that indicates if the Tj was inserted. It is useful to evite unnecesary iterations in joinTj recursive function
+    int T_sup_height = treeHeight(T_sup); // leaves of T_sup are at this depth
 
     // for each Tj in T_prime, insert Tj into the corresponding leaf in T_sup
     for (int j=0; j < T_prime_size; j++) {
         Tj_inserted = 0; // begin with the Tj is not inserted still
         PointAndNode *Tj = &T_prime[j]; // Obtain Tj from T_prime
-        joinTj(T_sup, Tj, &Tj_inserted); // insert Tj into a T_sup leaf
+        joinTj(T_sup, Tj, &Tj_inserted, T_sup_height); // insert Tj into a T_sup leaf
     }
 
 
-    free(F);
+    destroy_arena(scratch);
 
     // STEP 12
 
@@ -413,4 +490,54 @@ Node* ciacciaPatella(Point* P, int P_size) {
 
     // return T_sup
     return T_sup;
-}
\ No newline at end of file
+}
+
+// Function that builds the tree of the P_size points of P with the CP algorithm, see cpBuildFromSource
+Node* cpBuild(Point* P, int P_size, unsigned int seed, TaskScheduler* scheduler) {
+    PointSource source = memory_point_source(P, P_size);
+    return cpBuildFromSource(&source, seed, scheduler);
+}
+
+// Función que construye un M-tree con el método de Ciaccia-Patella usando la semilla seed para las elecciones aleatorias
+Node* ciacciaPatellaSeeded(Point* P, int P_size, unsigned int seed) {
+    return cpBuild(P, P_size, seed, NULL);
+}
+
+// Función que construye un M-tree con el método de Ciaccia-Patella
+Node* ciacciaPatella(Point* P, int P_size) {
+    return ciacciaPatellaSeeded(P, P_size, (unsigned int)rand());
+}
+
+// Función que construye un M-tree con el método de Ciaccia-Patella con los puntos de source (por ejemplo un archivo de puntos),
+// usando la semilla seed. Da el mismo árbol que ciacciaPatellaSeeded con los mismos puntos en un arreglo
+Node* ciacciaPatellaFromSource(PointSource* source, unsigned int seed) {
+    return cpBuildFromSource(source, seed, NULL);
+}
+
+// Función que construye con los hilos de pool el mismo árbol que ciacciaPatellaSeeded con la semilla seed, construyendo los subárboles del paso 6 como tareas
+Node* ciacciaPatellaParallel(Point* P, int P_size, unsigned int seed, ThreadPool* pool) {
+    TaskScheduler* scheduler = create_task_scheduler(pool);
+    CPTask root = {P, P_size, seed, scheduler, NULL};
+
+    run_task_scheduler(scheduler, cpTask, &root);
+
+    destroy_task_scheduler(scheduler);
+    return root.result;
+}
+
+// Función que determina si dos árboles tienen los mismos puntos, radios y estructura
+int equalTrees(Node* t1, Node* t2) {
+    if (t1 == NULL || t2 == NULL)
+        return t1 == t2;
+    if (t1->num_entries != t2->num_entries)
+        return 0;
+    for (int i = 0; i < t1->num_entries; i++) {
+        Entry e1 = t1->entries[i];
+        Entry e2 = t2->entries[i];
+        if (e1.p.x != e2.p.x || e1.p.y != e2.p.y || e1.cr != e2.cr || !equalTrees(e1.a, e2.a))
+            return 0;
+    }
+    return 1;
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef DELETE_C
+#define DELETE_C
+
+#include "insert.c"
+
+// Si es 1, mtree_delete recalcula los radios cobertores del camino desde la hoja hasta la raíz después de borrar,
+// para que no queden más grandes que sus subárboles. Si es 0 solo se recalculan los radios de los nodos que se unen o redistribuyen
+int delete_tighten_radii = 1;
+
+// Función que retorna 1 si node es una hoja
+int is_leaf_node(Node* node) {
+    return node->num_entries == 0 || node->entries[0].a == NULL;
+}
+
+// Función que retorna el radio cobertor de la entrada que apunta a child: la mayor distancia de su punto a una entrada
+// de child (guardada en pd) más el radio de esa entrada
+double covering_radius(Node* child) {
+    double radius = 0.0;
+    for (int i = 0; i < child->num_entries; i++) {
+        double reach = child->entries[i].pd + child->entries[i].cr;
+        if (reach > radius)
+            radius = reach;
+    }
+    return radius;
+}
+
+// Función que libera un nodo que dejó de estar en el árbol. Los nodos de un arena se liberan con el arena
+void release_node(Node* node) {
+    if (node_arena == NULL) {
+        free(node->entries);
+        free(node);
+    }
+}
+
+// Función que elimina la entrada i de node, moviendo la última a su lugar
+void remove_entry(Node* node, int i) {
+    node->entries[i] = node->entries[--node->num_entries];
+}
+
+// Función que arregla el nodo hijo de la entrada i de parent, que quedó con menos de b entradas. Si la entrada hermana
+// más cercana tiene espacio se unen en un solo nodo; si no, la hermana le pasa sus entradas más cercanas hasta que tenga b
+void fix_underflow(Node* parent, int i) {
+    Entry* e = &parent->entries[i];
+    Node* child = e->a;
+
+    // the closest sibling at the same level, so that the merged or redistributed node stays compact
+    int sibling = -1;
+    double best = DBL_MAX;
+    for (int k = 0; k < parent->num_entries; k++) {
+        Entry s = parent->entries[k];
+        if (k == i || s.a == NULL || is_leaf_node(s.a) != is_leaf_node(child))
+            continue;
+        double d = squared_distance(e->p, s.p);
+        if (d < best) {
+            best = d;
+            sibling = k;
+        }
+    }
+
+    if (sibling == -1) {
+        // an empty child without siblings is dropped, a non empty one stays with fewer than b entries
+        if (child->num_entries == 0) {
+            remove_entry(parent, i);
+            release_node(child);
+        }
+        return;
+    }
+
+    Entry* s = &parent->entries[sibling];
+    Node* other = s->a;
+    if (child->num_entries + other->num_entries <= B) {
+        reserve_node_entries(other);
+        memcpy(other->entries + other->num_entries, child->entries, child->num_entries * sizeof(Entry));
+        other->num_entries += child->num_entries;
+        set_parent_distances(other, s->p);
+        s->cr = covering_radius(other);
+        s->count = subtree_count(other);
+        remove_entry(parent, i);
+        release_node(child);
+        return;
+    }
+
+    // the sibling keeps more than b entries since both together have more than B
+    reserve_node_entries(child);
+    while (child->num_entries < b) {
+        int nearest = 0;
+        double nearest_distance = DBL_MAX;
+        for (int k = 0; k < other->num_entries; k++) {
+            double d = squared_distance(e->p, other->entries[k].p);
+            if (d < nearest_distance) {
+                nearest_distance = d;
+                nearest = k;
+            }
+        }
+        child->entries[child->num_entries++] = other->entries[nearest];
+        child->entries[child->num_entries - 1].pd = sqrt(nearest_distance);
+        remove_entry(other, nearest);
+    }
+    e->cr = covering_radius(child);
+    s->cr = covering_radius(other);
+    e->count = subtree_count(child);
+    s->count = subtree_count(other);
+}
+
+// Función que borra p del subárbol node. Retorna 1 si lo encontró, y deja en underflow si node quedó con menos de b entradas
+int delete_from_subtree(Node* node, Point p, int* underflow) {
+    for (int i = 0; i < node->num_entries; i++) {
+        Entry* e = &node->entries[i];
+        if (e->a == NULL) {
+            if (e->p.x == p.x && e->p.y == p.y) {
+                remove_entry(node, i);
+                *underflow = node->num_entries < b;
+                return 1;
+            }
+            continue;
+        }
+
+        // only subtrees whose ball contains p can store it
+        if (euclidean_distance(e->p, p) > e->cr)
+            continue;
+        int child_underflow = 0;
+        if (!delete_from_subtree(e->a, p, &child_underflow))
+            continue;
+        e->count--;
+
+        if (child_underflow)
+            fix_underflow(node, i);
+        else if (delete_tighten_radii)
+            e->cr = covering_radius(e->a);
+        *underflow = node->num_entries < b;
+        return 1;
+    }
+    return 0;
+}
+
+// Función que borra una aparición del punto p del árbol root. Los nodos con menos de b entradas se unen con su hermano
+// más cercano o reciben entradas de él. La raíz conserva su dirección: si queda con un solo hijo, sus entradas suben a la raíz.
+// Retorna 1 si encontró el punto. Si el árbol se construyó en un arena, node_arena debe seguir apuntando a ese arena
+int mtree_delete(Node* root, Point p) {
+    int underflow = 0;
+    if (!delete_from_subtree(root, p, &underflow))
+        return 0;
+
+    while (root->num_entries == 1 && root->entries[0].a != NULL) {
+        Node* child = root->entries[0].a;
+        if (child->num_entries > root->capacity)
+            reserve_node_entries(root);
+        memcpy(root->entries, child->entries, child->num_entries * sizeof(Entry));
+        root->num_entries = child->num_entries;
+        release_node(child);
+    }
+    return 1;
+}
+
+#endif
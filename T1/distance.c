@@ -0,0 +1,323 @@
+#ifndef DISTANCE_C
+#define DISTANCE_C
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DISTANCE_X86 1
+#endif
+
+// Funciones de distancia sobre arreglos de puntos 2D. Un punto son dos doubles seguidos (x, y) y stride es la cantidad de
+// doubles entre un punto y el siguiente, para recorrer tanto arreglos de Point (stride 2) como los puntos de arreglos de Entry.
+// Se comparan distancias al cuadrado, sin sqrt. Cada función tiene versiones escalar, SSE2, AVX2 y AVX-512, y al iniciar
+// el programa se elige la más rápida que soporta la CPU
+
+typedef struct distancekernels DistanceKernels;
+
+// Estructura con una versión de las funciones de distancia
+struct distancekernels {
+    const char* name;
+    // guarda en out[k] el cuadrado de la distancia entre q y el punto k
+    void (*squared_distances)(const double* q, const double* points, int stride, int n, double* out);
+    // guarda en hits los índices de los puntos a distancia al cuadrado <= r2 de q y retorna cuántos son
+    int (*points_within)(const double* q, const double* points, int stride, int n, double r2, int* hits);
+};
+
+// Las versiones solo dan los mismos resultados si ninguna contrae dx * dx + dy * dy a una FMA, que redondea una vez
+// en vez de dos. GCC lo hace por defecto al compilar con -march=native o dentro de funciones con target("avx2")
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+// Función que calcula las distancias al cuadrado de q a n puntos, uno a la vez
+void squared_distances_scalar(const double* q, const double* points, int stride, int n, double* out) {
+    for (int k = 0; k < n; k++) {
+        const double* p = points + (size_t)k * stride;
+        double dx = p[0] - q[0];
+        double dy = p[1] - q[1];
+        out[k] = dx * dx + dy * dy;
+    }
+}
+
+// Función que busca los puntos a distancia al cuadrado <= r2 de q, uno a la vez
+int points_within_scalar(const double* q, const double* points, int stride, int n, double r2, int* hits) {
+    int count = 0;
+    for (int k = 0; k < n; k++) {
+        const double* p = points + (size_t)k * stride;
+        double dx = p[0] - q[0];
+        double dy = p[1] - q[1];
+        if (dx * dx + dy * dy <= r2)
+            hits[count++] = k;
+    }
+    return count;
+}
+
+#ifdef DISTANCE_X86
+
+// Función que calcula con SSE2 las distancias al cuadrado de q a los puntos p0 y p1
+__attribute__((target("sse2")))
+static inline __m128d two_distances_sse2(__m128d vq, const double* p0, const double* p1) {
+    __m128d d0 = _mm_sub_pd(_mm_loadu_pd(p0), vq);
+    __m128d d1 = _mm_sub_pd(_mm_loadu_pd(p1), vq);
+    d0 = _mm_mul_pd(d0, d0);
+    d1 = _mm_mul_pd(d1, d1);
+    // (dx0^2, dx1^2) + (dy0^2, dy1^2)
+    return _mm_add_pd(_mm_unpacklo_pd(d0, d1), _mm_unpackhi_pd(d0, d1));
+}
+
+// Función que calcula las distancias al cuadrado de q a n puntos, de a 2 con SSE2
+__attribute__((target("sse2")))
+void squared_distances_sse2(const double* q, const double* points, int stride, int n, double* out) {
+    __m128d vq = _mm_loadu_pd(q);
+    int k = 0;
+    for (; k + 2 <= n; k += 2) {
+        const double* p = points + (size_t)k * stride;
+        _mm_storeu_pd(out + k, two_distances_sse2(vq, p, p + stride));
+    }
+    squared_distances_scalar(q, points + (size_t)k * stride, stride, n - k, out + k);
+}
+
+// Función que busca los puntos a distancia al cuadrado <= r2 de q, de a 2 con SSE2
+__attribute__((target("sse2")))
+int points_within_sse2(const double* q, const double* points, int stride, int n, double r2, int* hits) {
+    __m128d vq = _mm_loadu_pd(q);
+    __m128d vr2 = _mm_set1_pd(r2);
+    int count = 0;
+    int k = 0;
+    for (; k + 2 <= n; k += 2) {
+        const double* p = points + (size_t)k * stride;
+        int mask = _mm_movemask_pd(_mm_cmple_pd(two_distances_sse2(vq, p, p + stride), vr2));
+        if (mask & 1)
+            hits[count++] = k;
+        if (mask & 2)
+            hits[count++] = k + 1;
+    }
+    int tail = points_within_scalar(q, points + (size_t)k * stride, stride, n - k, r2, hits + count);
+    for (int t = 0; t < tail; t++)
+        hits[count + t] += k;
+    return count + tail;
+}
+
+// Función que calcula con AVX2 las distancias al cuadrado de q a los 4 puntos que parten en p
+__attribute__((target("avx2")))
+static inline __m256d four_distances_avx2(__m256d vq, const double* p, int stride) {
+    __m256d a = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(p)), _mm_loadu_pd(p + stride), 1);
+    __m256d c = _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(p + 2 * stride)), _mm_loadu_pd(p + 3 * stride), 1);
+    a = _mm256_sub_pd(a, vq);
+    c = _mm256_sub_pd(c, vq);
+    a = _mm256_mul_pd(a, a);
+    c = _mm256_mul_pd(c, c);
+    // hadd leaves the sums as (d0, d2, d1, d3)
+    return _mm256_permute4x64_pd(_mm256_hadd_pd(a, c), 0xD8);
+}
+
+// Función que calcula las distancias al cuadrado de q a n puntos, de a 4 con AVX2
+__attribute__((target("avx2")))
+void squared_distances_avx2(const double* q, const double* points, int stride, int n, double* out) {
+    __m256d vq = _mm256_setr_pd(q[0], q[1], q[0], q[1]);
+    int k = 0;
+    for (; k + 4 <= n; k += 4)
+        _mm256_storeu_pd(out + k, four_distances_avx2(vq, points + (size_t)k * stride, stride));
+    squared_distances_scalar(q, points + (size_t)k * stride, stride, n - k, out + k);
+}
+
+// Función que busca los puntos a distancia al cuadrado <= r2 de q, de a 4 con AVX2
+__attribute__((target("avx2")))
+int points_within_avx2(const double* q, const double* points, int stride, int n, double r2, int* hits) {
+    __m256d vq = _mm256_setr_pd(q[0], q[1], q[0], q[1]);
+    __m256d vr2 = _mm256_set1_pd(r2);
+    int count = 0;
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d d2 = four_distances_avx2(vq, points + (size_t)k * stride, stride);
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(d2, vr2, _CMP_LE_OQ));
+        while (mask != 0) {
+            hits[count++] = k + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    int tail = points_within_scalar(q, points + (size_t)k * stride, stride, n - k, r2, hits + count);
+    for (int t = 0; t < tail; t++)
+        hits[count + t] += k;
+    return count + tail;
+}
+
+// Función que calcula con AVX-512 las distancias al cuadrado de q a los 8 puntos que parten en p
+__attribute__((target("avx512f")))
+static inline __m512d eight_distances_avx512(__m512d vq, const double* p, int stride) {
+    __m512d a = _mm512_castpd256_pd512(_mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(p)), _mm_loadu_pd(p + stride), 1));
+    a = _mm512_insertf64x4(a, _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(p + 2 * stride)), _mm_loadu_pd(p + 3 * stride), 1), 1);
+    __m512d c = _mm512_castpd256_pd512(_mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(p + 4 * stride)), _mm_loadu_pd(p + 5 * stride), 1));
+    c = _mm512_insertf64x4(c, _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd(p + 6 * stride)), _mm_loadu_pd(p + 7 * stride), 1), 1);
+    a = _mm512_sub_pd(a, vq);
+    c = _mm512_sub_pd(c, vq);
+    a = _mm512_mul_pd(a, a);
+    c = _mm512_mul_pd(c, c);
+    // gather the dx^2 and dy^2 of the 8 points, in order, and add them
+    __m512i even = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+    __m512i odd = _mm512_setr_epi64(1, 3, 5, 7, 9, 11, 13, 15);
+    return _mm512_add_pd(_mm512_permutex2var_pd(a, even, c), _mm512_permutex2var_pd(a, odd, c));
+}
+
+// Función que calcula con AVX2 las distancias al cuadrado de q a los últimos n < 8 puntos, para la versión AVX-512.
+// El último bloque de menos de 4 puntos se completa con copias de q. Así todas las distancias pasan por las mismas
+// instrucciones vectoriales, sin un ciclo escalar que el compilador podría contraer a FMA y redondear distinto
+__attribute__((target("avx512f")))
+static inline void tail_distances_avx512(const double* q, const double* points, int stride, int n, double* out) {
+    __m256d vq = _mm256_setr_pd(q[0], q[1], q[0], q[1]);
+    if (n >= 4) {
+        _mm256_storeu_pd(out, four_distances_avx2(vq, points, stride));
+        points += (size_t)4 * stride;
+        out += 4;
+        n -= 4;
+    }
+    if (n > 0) {
+        double block[8];
+        for (int k = 0; k < 4; k++) {
+            const double* p = k < n ? points + (size_t)k * stride : q;
+            block[2 * k] = p[0];
+            block[2 * k + 1] = p[1];
+        }
+        double distances[4];
+        _mm256_storeu_pd(distances, four_distances_avx2(vq, block, 2));
+        for (int k = 0; k < n; k++)
+            out[k] = distances[k];
+    }
+}
+
+// Función que calcula las distancias al cuadrado de q a n puntos, de a 8 con AVX-512
+__attribute__((target("avx512f")))
+void squared_distances_avx512(const double* q, const double* points, int stride, int n, double* out) {
+    __m512d vq = _mm512_setr_pd(q[0], q[1], q[0], q[1], q[0], q[1], q[0], q[1]);
+    int k = 0;
+    for (; k + 8 <= n; k += 8)
+        _mm512_storeu_pd(out + k, eight_distances_avx512(vq, points + (size_t)k * stride, stride));
+    if (k < n)
+        tail_distances_avx512(q, points + (size_t)k * stride, stride, n - k, out + k);
+}
+
+// Función que busca los puntos a distancia al cuadrado <= r2 de q, de a 8 con AVX-512
+__attribute__((target("avx512f")))
+int points_within_avx512(const double* q, const double* points, int stride, int n, double r2, int* hits) {
+    __m512d vq = _mm512_setr_pd(q[0], q[1], q[0], q[1], q[0], q[1], q[0], q[1]);
+    __m512d vr2 = _mm512_set1_pd(r2);
+    int count = 0;
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m512d d2 = eight_distances_avx512(vq, points + (size_t)k * stride, stride);
+        int mask = _mm512_cmp_pd_mask(d2, vr2, _CMP_LE_OQ);
+        while (mask != 0) {
+            hits[count++] = k + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    if (k < n) {
+        double tail[8];
+        tail_distances_avx512(q, points + (size_t)k * stride, stride, n - k, tail);
+        for (int t = 0; k + t < n; t++) {
+            if (tail[t] <= r2)
+                hits[count++] = k + t;
+        }
+    }
+    return count;
+}
+
+#endif
+
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT DEFAULT
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+// Versiones disponibles, de la más lenta a la más rápida
+DistanceKernels distance_kernels_list[] = {
+    {"scalar", squared_distances_scalar, points_within_scalar},
+#ifdef DISTANCE_X86
+    {"sse2", squared_distances_sse2, points_within_sse2},
+    {"avx2", squared_distances_avx2, points_within_avx2},
+    {"avx512", squared_distances_avx512, points_within_avx512},
+#endif
+};
+
+#define NUM_DISTANCE_KERNELS ((int)(sizeof(distance_kernels_list) / sizeof(DistanceKernels)))
+
+// Versión usada por squared_distances y points_within
+DistanceKernels distance_kernels = {"scalar", squared_distances_scalar, points_within_scalar};
+
+// Función que determina si la CPU soporta la versión llamada name
+int distance_kernels_supported(const char* name) {
+    if (strcmp(name, "scalar") == 0)
+        return 1;
+#ifdef DISTANCE_X86
+    if (strcmp(name, "sse2") == 0)
+        return __builtin_cpu_supports("sse2");
+    if (strcmp(name, "avx2") == 0)
+        return __builtin_cpu_supports("avx2");
+    if (strcmp(name, "avx512") == 0)
+        return __builtin_cpu_supports("avx512f");
+#endif
+    return 0;
+}
+
+// Función que cambia la versión usada a la llamada name. Retorna 0 si tuvo éxito y -1 si no existe o la CPU no la soporta
+int set_distance_kernels(const char* name) {
+    for (int i = 0; i < NUM_DISTANCE_KERNELS; i++) {
+        if (strcmp(distance_kernels_list[i].name, name) == 0 && distance_kernels_supported(name)) {
+            distance_kernels = distance_kernels_list[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Función que elige la versión más rápida que soporta la CPU, al iniciar el programa
+__attribute__((constructor))
+void select_distance_kernels() {
+    for (int i = 0; i < NUM_DISTANCE_KERNELS; i++) {
+        if (distance_kernels_supported(distance_kernels_list[i].name))
+            distance_kernels = distance_kernels_list[i];
+    }
+}
+
+// Función que guarda en out[k] el cuadrado de la distancia entre q y el punto k de points
+void squared_distances(const double* q, const double* points, int stride, int n, double* out) {
+    distance_kernels.squared_distances(q, points, stride, n, out);
+}
+
+// Función que guarda en hits los índices de los puntos de points a distancia al cuadrado <= r2 de q y retorna cuántos son
+int points_within(const double* q, const double* points, int stride, int n, double r2, int* hits) {
+    return distance_kernels.points_within(q, points, stride, n, r2, hits);
+}
+
+// Función que calcula las distancias al cuadrado entre cada punto de as y cada punto de points. La fila i de out
+// (n valores) tiene las distancias del punto i de as
+void squared_distance_matrix(const double* as, int stride_as, int num_as, const double* points, int stride, int n, double* out) {
+    for (int i = 0; i < num_as; i++)
+        distance_kernels.squared_distances(as + (size_t)i * stride_as, points, stride, n, out + (size_t)i * n);
+}
+
+// Función que retorna el índice del punto de points más cercano a q (el primero si hay empates) y guarda el cuadrado de su distancia en nearest_d2
+int nearest_point(const double* q, const double* points, int stride, int n, double* nearest_d2) {
+    double block[64];
+    int nearest = -1;
+    double best = __DBL_MAX__;
+    for (int k = 0; k < n; k += 64) {
+        int m = n - k < 64 ? n - k : 64;
+        distance_kernels.squared_distances(q, points + (size_t)k * stride, stride, m, block);
+        for (int t = 0; t < m; t++) {
+            if (block[t] < best) {
+                best = block[t];
+                nearest = k + t;
+            }
+        }
+    }
+    *nearest_d2 = best;
+    return nearest;
+}
+
+#endif
@@ -0,0 +1,442 @@
+#ifndef EXTERNAL_C
+#define EXTERNAL_C
+
+#include "cp.c"
+#include "pager.c"
+
+// Bytes de memoria por punto que se estiman para construir un subárbol en memoria con cpBuild: el arreglo de puntos,
+// los subconjuntos Fj de cada nivel de la recursión y los nodos del subárbol
+#define EXTERNAL_BYTES_PER_POINT (8 * sizeof(Point))
+
+// Cantidad mínima y máxima de puntos que junta en memoria cada archivo de partición antes de escribirlos. Entre esas cotas,
+// los K buffers de un reparto se reparten el presupuesto de memoria
+#define SPILL_BUFFER_MIN_POINTS 64
+#define SPILL_BUFFER_MAX_POINTS 4096
+
+typedef struct disksubtree DiskSubtree;
+typedef struct spillfile SpillFile;
+typedef struct externalbuild ExternalBuild;
+
+// Estructura que representa un subárbol ya escrito en el archivo de páginas, junto al punto que lo representa en F.
+// Si page es 0 el subárbol es solo el punto p (altura 0)
+struct disksubtree {
+    Point p;
+    uint32_t page;
+    int entries; // entries of the root page
+    int h;
+};
+
+// Estructura que representa el archivo temporal de una partición Fj, escrito en orden como un archivo de puntos
+struct spillfile {
+    char path[512];
+    int fd;
+    Point* buffer;
+    int capacity; // points the buffer holds
+    int buffered;
+    int count;
+};
+
+// Estructura con el estado de una construcción fuera de memoria
+struct externalbuild {
+    int fd; // paged tree being written
+    uint32_t next_page;
+    size_t memory_budget;
+    const char* tmp_dir;
+    int next_file; // number of the next partition file
+    long spilled_points; // points written to partition files
+    int partitions; // partition files created
+    int memory_builds; // subtrees built in memory
+    int unused_pages; // pages of roots dropped in steps 7 and 9, left in the file without being referenced
+};
+
+// Función que crea el archivo de una nueva partición en el directorio temporal de build, con un buffer de capacity puntos
+void open_spill_file(ExternalBuild* build, SpillFile* spill, int capacity) {
+    snprintf(spill->path, sizeof(spill->path), "%s/cp-partition-%i.bin", build->tmp_dir, build->next_file++);
+    spill->fd = open(spill->path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (spill->fd < 0) {
+        printf("No se pudo crear el archivo temporal %s.\n", spill->path);
+        exit(1);
+    }
+    spill->buffer = (Point*)malloc(capacity * sizeof(Point));
+    spill->capacity = capacity;
+    spill->buffered = 0;
+    spill->count = 0;
+    build->partitions++;
+}
+
+// Función que escribe al final del archivo los puntos que la partición tiene en memoria
+void flush_spill_file(SpillFile* spill) {
+    size_t bytes = spill->buffered * sizeof(Point);
+    off_t offset = sizeof(PointFileHeader) + (off_t)(spill->count - spill->buffered) * sizeof(Point);
+    if (bytes > 0 && pwrite(spill->fd, spill->buffer, bytes, offset) != (ssize_t)bytes) {
+        printf("Error escribiendo el archivo temporal %s.\n", spill->path);
+        exit(1);
+    }
+    spill->buffered = 0;
+}
+
+// Función que agrega p al final de la partición
+void spill_point(ExternalBuild* build, SpillFile* spill, Point p) {
+    spill->buffer[spill->buffered++] = p;
+    spill->count++;
+    build->spilled_points++;
+    if (spill->buffered == spill->capacity)
+        flush_spill_file(spill);
+}
+
+// Función que termina de escribir la partición con su encabezado de archivo de puntos y libera su buffer
+void finish_spill_file(SpillFile* spill) {
+    flush_spill_file(spill);
+    PointFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, POINT_FILE_MAGIC, sizeof(header.magic));
+    header.point_size = sizeof(Point);
+    header.count = spill->count;
+    if (pwrite(spill->fd, &header, sizeof(header), 0) != sizeof(header)) {
+        printf("Error escribiendo el archivo temporal %s.\n", spill->path);
+        exit(1);
+    }
+    close(spill->fd);
+    free(spill->buffer);
+    spill->buffer = NULL;
+}
+
+// Función que lee las entradas de una página ya escrita del árbol
+void read_tree_page(ExternalBuild* build, uint32_t page, DiskEntry* entries) {
+    if (pread(build->fd, entries, DISK_PAGE_SIZE, (off_t)page * DISK_PAGE_SIZE) != DISK_PAGE_SIZE) {
+        printf("Error leyendo la página %u del árbol.\n", page);
+        exit(1);
+    }
+}
+
+// Función que construye en memoria con cpBuild el subárbol de los puntos de source y lo escribe desde la página root_page
+// (o una página nueva si es 0). Los nodos se toman de un arena propio que se libera al terminar
+int build_subtree_in_memory(ExternalBuild* build, PointSource* source, unsigned int seed, uint32_t root_page, DiskSubtree* result) {
+    Point* P = (Point*)malloc(source->size * sizeof(Point));
+    int chunk_size;
+    for (int first = 0; first < source->size; first += chunk_size) {
+        const Point* chunk = point_source_chunk(source, first, &chunk_size);
+        memcpy(P + first, chunk, chunk_size * sizeof(Point));
+    }
+
+    Arena* saved_arena = node_arena;
+    node_arena = create_arena(ARENA_BLOCK_SIZE, 0);
+    Node* T = cpBuild(P, source->size, seed, NULL);
+
+    if (root_page == 0)
+        root_page = build->next_page++;
+    int status = write_node_page(build->fd, T, root_page, &build->next_page);
+    result->page = root_page;
+    result->entries = T->num_entries;
+    result->h = treeHeight(T);
+    build->memory_builds++;
+
+    destroy_arena(node_arena);
+    node_arena = saved_arena;
+    free(P);
+    return status;
+}
+
+// Función que agrega un subárbol guardado a un arreglo del arena scratch, duplicando su capacidad cuando se llena
+void addDiskSubtree(Arena* scratch, DiskSubtree** array, DiskSubtree T, int* array_size, int* array_capacity) {
+    if (*array_size == *array_capacity) {
+        int capacity = *array_capacity == 0 ? 16 : 2 * *array_capacity;
+        *array = (DiskSubtree*)arena_realloc(scratch, *array, *array_capacity * sizeof(DiskSubtree), capacity * sizeof(DiskSubtree));
+        *array_capacity = capacity;
+    }
+    (*array)[(*array_size)++] = T;
+}
+
+// Función que agrega a T_prime los subárboles de altura h que hay bajo el subárbol guardado T, y sus puntos a F.
+// Las páginas de T y de sus descendientes más altos que h dejan de usarse
+void addDiskSubtreesOfHeight(ExternalBuild* build, Arena* scratch, DiskSubtree T, int h, DiskSubtree** T_prime, int* T_prime_size, int* T_prime_capacity,
+                             Point** F, int* F_size, int* F_capacity) {
+    DiskEntry entries[PAGE_ENTRIES];
+    read_tree_page(build, T.page, entries);
+    build->unused_pages++;
+    for (int i = 0; i < T.entries; i++) {
+        DiskSubtree child = {entries[i].p, entries[i].child, entries[i].child_entries, T.h - 1};
+        if (child.h == h) {
+            addDiskSubtree(scratch, T_prime, child, T_prime_size, T_prime_capacity);
+            addPointToArray(scratch, F, child.p, F_size, F_capacity);
+        }
+        else {
+            addDiskSubtreesOfHeight(build, scratch, child, h, T_prime, T_prime_size, T_prime_capacity, F, F_size, F_capacity);
+        }
+    }
+}
+
+// Función que, como joinTj, busca la hoja de Tsup cuyo punto es p y guarda en su campo count el índice del subárbol de T' que le corresponde
+void linkTj(Node* Tsup, Point p, int index, int* already_linked, int levels) {
+    for (int i = 0; i < Tsup->num_entries && !*already_linked; i++) {
+        Entry* entry = &Tsup->entries[i];
+        if (levels == 1) {
+            if (entry->p.x == p.x && entry->p.y == p.y) {
+                entry->count = index;
+                *already_linked = 1;
+            }
+        }
+        else {
+            linkTj(entry->a, p, index, already_linked, levels - 1);
+        }
+    }
+}
+
+// Función que calcula los radios cobertores de Tsup como setCoveringRadius. Las entradas de sus hojas cubren la raíz del subárbol de T_prime que tienen enlazado
+void setExternalCoveringRadius(ExternalBuild* build, Node* node, int levels, DiskSubtree* T_prime) {
+    for (int i = 0; i < node->num_entries; i++) {
+        Entry* e = &node->entries[i];
+        double max_distance = 0;
+        if (levels == 1) {
+            DiskSubtree Tj = T_prime[e->count];
+            if (Tj.page != 0) {
+                DiskEntry entries[PAGE_ENTRIES];
+                read_tree_page(build, Tj.page, entries);
+                for (int j = 0; j < Tj.entries; j++)
+                    max_distance = fmax(max_distance, euclidean_distance(e->p, entries[j].p) + entries[j].cr);
+            }
+        }
+        else {
+            setExternalCoveringRadius(build, e->a, levels - 1, T_prime);
+            for (int j = 0; j < e->a->num_entries; j++)
+                max_distance = fmax(max_distance, euclidean_distance(e->p, e->a->entries[j].p) + e->a->entries[j].cr);
+        }
+        e->cr = max_distance;
+    }
+}
+
+// Función que escribe Tsup en la página page_id como write_node_page, pero las entradas de sus hojas apuntan a la raíz del subárbol de T_prime que tienen enlazado
+int write_external_page(ExternalBuild* build, Node* node, int levels, uint32_t page_id, DiskSubtree* T_prime) {
+    DiskEntry page[PAGE_ENTRIES];
+    memset(page, 0, sizeof(page));
+    uint32_t first_child = build->next_page;
+
+    if (node->num_entries > (int)PAGE_ENTRIES)
+        return -1;
+    for (int i = 0; i < node->num_entries; i++) {
+        Entry e = node->entries[i];
+        page[i].p = e.p;
+        page[i].cr = e.cr;
+        if (levels == 1) {
+            page[i].child = T_prime[e.count].page;
+            page[i].child_entries = T_prime[e.count].entries;
+        }
+        else {
+            page[i].child = build->next_page++;
+            page[i].child_entries = e.a->num_entries;
+        }
+    }
+    if (pwrite(build->fd, page, DISK_PAGE_SIZE, (off_t)page_id * DISK_PAGE_SIZE) != DISK_PAGE_SIZE)
+        return -1;
+
+    if (levels == 1)
+        return 0;
+    for (int i = 0; i < node->num_entries; i++) {
+        if (write_external_page(build, node->entries[i].a, levels - 1, first_child + i, T_prime) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Función que construye con el algoritmo CP el subárbol de los puntos de source y lo escribe en el archivo de build desde
+// la página root_page (o una página nueva si es 0). Si los puntos caben en el presupuesto de memoria se construye con cpBuild;
+// si no, se reparten en archivos temporales, uno por muestra, y se construye el subárbol de una partición a la vez.
+// Con la misma semilla el árbol es el mismo que construye cpBuild con los puntos en memoria
+int cpBuildExternal(ExternalBuild* build, PointSource* source, unsigned int seed, uint32_t root_page, DiskSubtree* result) {
+    int P_size = source->size;
+    if (P_size <= B || (size_t)P_size * EXTERNAL_BYTES_PER_POINT <= build->memory_budget)
+        return build_subtree_in_memory(build, source, seed, root_page, result);
+
+    int K = intMin(B, (int)ceil((double)P_size / B));
+    int F_size;
+    int F_capacity = K;
+    Arena* scratch = create_arena(ARENA_BLOCK_SIZE, 0);
+    Point* F = (Point*)arena_alloc(scratch, K * sizeof(Point));
+    Point* samples = (Point*)arena_alloc(scratch, K * sizeof(Point));
+    int* sample_indices = (int*)arena_alloc(scratch, K * sizeof(int));
+    int* working = (int*)arena_alloc(scratch, K * sizeof(int));
+    SpillFile* partitions = (SpillFile*)arena_alloc(scratch, K * sizeof(SpillFile));
+
+    // the K buffers are in memory at the same time, while the points of this call are read from source, so they share the budget
+    size_t spill_points = build->memory_budget / K / sizeof(Point);
+    int spill_capacity = spill_points < SPILL_BUFFER_MIN_POINTS ? SPILL_BUFFER_MIN_POINTS :
+                         spill_points > SPILL_BUFFER_MAX_POINTS ? SPILL_BUFFER_MAX_POINTS : (int)spill_points;
+
+    do {
+        // STEP 2, with the same random choices as cpBuild
+        F_size = K;
+        for (int i = 0; i < K; i++) {
+            while (1) {
+                int j = rand_r(&seed) % P_size;
+                int used = 0;
+                for (int k = 0; k < i; k++)
+                    used |= sample_indices[k] == j;
+                if (!used) {
+                    sample_indices[i] = j;
+                    samples[i] = F[i] = point_source_get(source, j);
+                    break;
+                }
+            }
+        }
+
+        // STEP 3: every point is appended to the partition file of its nearest sample, in the order of source
+        for (int j = 0; j < K; j++) {
+            open_spill_file(build, &partitions[j], spill_capacity);
+            working[j] = 1;
+        }
+        int chunk_size;
+        for (int first = 0; first < P_size; first += chunk_size) {
+            const Point* chunk = point_source_chunk(source, first, &chunk_size);
+            for (int i = 0; i < chunk_size; i++) {
+                double nearest_distance;
+                int nearest = nearest_point(&chunk[i].x, &samples[0].x, POINT_STRIDE, K, &nearest_distance);
+                spill_point(build, &partitions[nearest], chunk[i]);
+            }
+        }
+
+        // STEP 4: the points of partitions with fewer than b points are appended to the nearest working partition
+        for (int j = 0; j < K; j++) {
+            if (partitions[j].count >= b)
+                continue;
+            working[j] = 0;
+            deletePointInF(&F, &F_size, samples[j]);
+            finish_spill_file(&partitions[j]);
+            PointSource* Fj = open_point_source(partitions[j].path, 0);
+            int chunk_size;
+            for (int first = 0; first < Fj->size; first += chunk_size) {
+                const Point* chunk = point_source_chunk(Fj, first, &chunk_size);
+                for (int i = 0; i < chunk_size; i++) {
+                    double nearest_distance = DBL_MAX;
+                    int nearest = -1;
+                    for (int l = 0; l < K; l++) {
+                        if (!working[l])
+                            continue;
+                        double distance = squared_distance(chunk[i], samples[l]);
+                        if (distance < nearest_distance) {
+                            nearest_distance = distance;
+                            nearest = l;
+                        }
+                    }
+                    spill_point(build, &partitions[nearest], chunk[i]);
+                }
+            }
+            close_point_source(Fj);
+            unlink(partitions[j].path);
+        }
+
+        for (int j = 0; j < K; j++) {
+            if (working[j])
+                finish_spill_file(&partitions[j]);
+        }
+        if (F_size == 1) { // STEP 5: start again with other samples
+            for (int j = 0; j < K; j++) {
+                if (working[j])
+                    unlink(partitions[j].path);
+            }
+        }
+    } while (F_size == 1);
+
+    // STEPS 6 and 7: one partition at a time is read back and turned into a subtree of the file
+    DiskSubtree* T = NULL;
+    int T_size = 0;
+    int T_capacity = 0;
+    for (int j = 0; j < K; j++) {
+        if (!working[j])
+            continue;
+
+        PointSource* Fj = open_point_source(partitions[j].path, 0);
+        DiskSubtree Tj;
+        int status = cpBuildExternal(build, Fj, deriveSeed(seed, j), 0, &Tj);
+        close_point_source(Fj);
+        unlink(partitions[j].path);
+        if (status != 0) {
+            destroy_arena(scratch);
+            return -1;
+        }
+
+        if (Tj.entries < b) {
+            // the root is too small, so its subtrees are used instead and its page is left unused
+            deletePointInF(&F, &F_size, samples[j]);
+            DiskEntry entries[PAGE_ENTRIES];
+            read_tree_page(build, Tj.page, entries);
+            build->unused_pages++;
+            for (int i = 0; i < Tj.entries; i++) {
+                DiskSubtree child = {entries[i].p, entries[i].child, entries[i].child_entries, Tj.h - 1};
+                addDiskSubtree(scratch, &T, child, &T_size, &T_capacity);
+                addPointToArray(scratch, &F, entries[i].p, &F_size, &F_capacity);
+            }
+        }
+        else {
+            Tj.p = samples[j];
+            addDiskSubtree(scratch, &T, Tj, &T_size, &T_capacity);
+        }
+    }
+
+    // STEP 8
+    int h = INT_MAX;
+    for (int j = 0; j < T_size; j++)
+        h = intMin(h, T[j].h);
+
+    // STEP 9
+    DiskSubtree* T_prime = NULL;
+    int T_prime_size = 0;
+    int T_prime_capacity = 0;
+    for (int j = 0; j < T_size; j++) {
+        if (T[j].h == h) {
+            addDiskSubtree(scratch, &T_prime, T[j], &T_prime_size, &T_prime_capacity);
+        }
+        else {
+            deletePointInF(&F, &F_size, T[j].p);
+            addDiskSubtreesOfHeight(build, scratch, T[j], h, &T_prime, &T_prime_size, &T_prime_capacity, &F, &F_size, &F_capacity);
+        }
+    }
+
+    // STEP 10: T_sup is small, it is built in memory
+    Arena* saved_arena = node_arena;
+    node_arena = create_arena(ARENA_BLOCK_SIZE, 0);
+    Node* T_sup = cpBuild(F, F_size, deriveSeed(seed, K), NULL);
+
+    // STEP 11: the leaves of T_sup point to the pages of the subtrees instead of nodes
+    int T_sup_height = treeHeight(T_sup);
+    for (int j = 0; j < T_prime_size; j++) {
+        int linked = 0;
+        linkTj(T_sup, T_prime[j].p, j, &linked, T_sup_height);
+    }
+
+    // STEP 12
+    setExternalCoveringRadius(build, T_sup, T_sup_height, T_prime);
+
+    if (root_page == 0)
+        root_page = build->next_page++;
+    int status = write_external_page(build, T_sup, T_sup_height, root_page, T_prime);
+    result->page = root_page;
+    result->entries = T_sup->num_entries;
+    result->h = T_sup_height + h;
+
+    destroy_arena(node_arena);
+    node_arena = saved_arena;
+    destroy_arena(scratch);
+    return status;
+}
+
+// Función que construye con el método de Ciaccia-Patella y la semilla seed el árbol de los puntos de source, sin tener
+// en memoria más de memory_budget bytes de puntos, y lo guarda en path con el formato de write_paged_tree.
+// Las particiones se escriben en archivos temporales en tmp_dir. Si stats no es NULL guarda ahí el estado final de la construcción.
+// Retorna 0 si tuvo éxito y -1 si no
+int ciacciaPatellaExternal(PointSource* source, unsigned int seed, size_t memory_budget, const char* tmp_dir, const char* path, ExternalBuild* stats) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+
+    ExternalBuild build = {fd, 2, memory_budget, tmp_dir, 0, 0, 0, 0, 0}; // page 0 is the header and page 1 the root
+    DiskSubtree root;
+    if (cpBuildExternal(&build, source, seed, 1, &root) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (stats != NULL)
+        *stats = build;
+    return finish_page_file(fd, PAGE_MAGIC, build.next_page, root.entries);
+}
+
+#endif
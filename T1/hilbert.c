@@ -0,0 +1,402 @@
+#ifndef HILBERT_C
+#define HILBERT_C
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "mtree.c"
+#include "threadpool.c"
+
+// Bits de cada coordenada en la curva de Hilbert: la grilla tiene 2^16 x 2^16 celdas y cada clave cabe en 32 bits
+#define HILBERT_ORDER 16
+
+// Bits de la clave que ordena cada pasada del radix sort
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// Cantidad de nodos que toma un hilo cada vez que pide trabajo
+#define HILBERT_NODE_CHUNK 16
+
+// Cantidad de puntos de los que se calcula la distancia a la vez al medir el radio cobertor exacto
+#define HILBERT_RADIUS_CHUNK 1024
+
+typedef struct hilbertlevel HilbertLevel;
+typedef struct hilbertbuild HilbertBuild;
+
+// Estructura que representa un nivel del árbol en construcción. Como los nodos se forman con puntos consecutivos en el
+// orden de la curva, los puntos del subárbol del nodo i son sorted[first[i]] a sorted[first[i] + count[i] - 1]
+struct hilbertlevel {
+    int size;
+    Node** nodes;
+    Point* routing; // medoid of each node, the point of the entry that points to it
+    double* radius; // exact covering radius around routing
+    int* first;
+    int* count;
+};
+
+// Estructura con el trabajo compartido por los hilos de hilbertBulkLoadParallel
+struct hilbertbuild {
+    const Point* P;
+    int n;
+    int num_threads;
+
+    // grid cell of each coordinate is (coordinate - low) * scale
+    Point low;
+    double scale;
+
+    // radix sort of the keys, carrying the index of each point
+    uint32_t* keys;
+    uint32_t* keys_tmp;
+    int* order;
+    int* order_tmp;
+    int shift;
+    int* histograms; // RADIX_BUCKETS counters per worker, turned into the position where each worker writes each bucket
+    Point* sorted;
+
+    // level being built from the one below
+    HilbertLevel* below; // NULL when building the leaves
+    HilbertLevel* level;
+    int* group_starts; // group g of the level below (or of the points) is group_starts[g] to group_starts[g + 1] - 1
+    atomic_int next;
+};
+
+// Función que retorna la posición en la curva de Hilbert de orden HILBERT_ORDER de la celda (x, y)
+uint32_t hilbert_key(uint32_t x, uint32_t y) {
+    uint32_t n = 1u << HILBERT_ORDER;
+    uint32_t key = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) > 0;
+        uint32_t ry = (y & s) > 0;
+        key += s * s * ((3 * rx) ^ ry);
+        // Rotate the quadrant so the curve inside it starts and ends next to its neighbours: with ry == 0 reflect it if
+        // rx == 1 (n - 1 - x is x ^ (n - 1)) and swap x and y. Masks instead of branches, since the bits are random
+        uint32_t reflect = -(rx & (ry ^ 1)) & (n - 1);
+        x ^= reflect;
+        y ^= reflect;
+        uint32_t swap = -(ry ^ 1) & (x ^ y);
+        x ^= swap;
+        y ^= swap;
+    }
+    return key;
+}
+
+// Función que guarda en first y last el rango de índices de n elementos que le toca al trabajador worker
+void worker_range(HilbertBuild* build, int worker, int n, int* first, int* last) {
+    *first = (int)((long)n * worker / build->num_threads);
+    *last = (int)((long)n * (worker + 1) / build->num_threads);
+}
+
+// Función que calcula la clave de Hilbert de los puntos que le tocan a worker
+void hilbert_keys_job(void* ctx, int worker) {
+    HilbertBuild* build = (HilbertBuild*)ctx;
+    uint32_t max_cell = (1u << HILBERT_ORDER) - 1;
+    int first, last;
+    worker_range(build, worker, build->n, &first, &last);
+
+    for (int i = first; i < last; i++) {
+        double cx = (build->P[i].x - build->low.x) * build->scale;
+        double cy = (build->P[i].y - build->low.y) * build->scale;
+        uint32_t x = cx < max_cell ? (uint32_t)cx : max_cell;
+        uint32_t y = cy < max_cell ? (uint32_t)cy : max_cell;
+        build->keys[i] = hilbert_key(x, y);
+        build->order[i] = i;
+    }
+}
+
+// Función que cuenta cuántas claves de las que le tocan a worker caen en cada balde de la pasada actual
+void radix_histogram_job(void* ctx, int worker) {
+    HilbertBuild* build = (HilbertBuild*)ctx;
+    int* histogram = build->histograms + worker * RADIX_BUCKETS;
+    int first, last;
+    worker_range(build, worker, build->n, &first, &last);
+
+    memset(histogram, 0, RADIX_BUCKETS * sizeof(int));
+    for (int i = first; i < last; i++)
+        histogram[(build->keys[i] >> build->shift) & (RADIX_BUCKETS - 1)]++;
+}
+
+// Función que escribe las claves que le tocan a worker en su balde, a partir de la posición que le asignó la suma de prefijos
+void radix_scatter_job(void* ctx, int worker) {
+    HilbertBuild* build = (HilbertBuild*)ctx;
+    int* position = build->histograms + worker * RADIX_BUCKETS;
+    int first, last;
+    worker_range(build, worker, build->n, &first, &last);
+
+    for (int i = first; i < last; i++) {
+        int j = position[(build->keys[i] >> build->shift) & (RADIX_BUCKETS - 1)]++;
+        build->keys_tmp[j] = build->keys[i];
+        build->order_tmp[j] = build->order[i];
+    }
+}
+
+// Función que copia en sorted los puntos que le tocan a worker, en el orden de sus claves
+void hilbert_gather_job(void* ctx, int worker) {
+    HilbertBuild* build = (HilbertBuild*)ctx;
+    int first, last;
+    worker_range(build, worker, build->n, &first, &last);
+
+    for (int i = first; i < last; i++)
+        build->sorted[i] = build->P[build->order[i]];
+}
+
+// Función que ejecuta job con los hilos de pool, o en este hilo si pool es NULL
+void hilbert_run(ThreadPool* pool, PoolJob job, HilbertBuild* build) {
+    if (pool != NULL)
+        thread_pool_run(pool, job, build);
+    else
+        job(build, 0);
+}
+
+// Función que ordena los puntos de build por su clave de Hilbert con un radix sort LSD de RADIX_BITS bits por pasada,
+// dejándolos en build->sorted. Cada hilo cuenta y reparte un rango fijo de claves, así que el orden es estable
+void hilbert_sort(HilbertBuild* build, ThreadPool* pool) {
+    int n = build->n;
+    build->keys = (uint32_t*)malloc(n * sizeof(uint32_t));
+    build->keys_tmp = (uint32_t*)malloc(n * sizeof(uint32_t));
+    build->order = (int*)malloc(n * sizeof(int));
+    build->order_tmp = (int*)malloc(n * sizeof(int));
+    build->histograms = (int*)malloc(build->num_threads * RADIX_BUCKETS * sizeof(int));
+
+    hilbert_run(pool, hilbert_keys_job, build);
+
+    for (build->shift = 0; build->shift < 2 * HILBERT_ORDER; build->shift += RADIX_BITS) {
+        hilbert_run(pool, radix_histogram_job, build);
+
+        // Bucket d of worker w starts after every smaller bucket and after bucket d of the previous workers
+        int position = 0;
+        int skip = 0;
+        for (int d = 0; d < RADIX_BUCKETS; d++) {
+            int bucket_size = 0;
+            for (int w = 0; w < build->num_threads; w++) {
+                int count = build->histograms[w * RADIX_BUCKETS + d];
+                build->histograms[w * RADIX_BUCKETS + d] = position;
+                position += count;
+                bucket_size += count;
+            }
+            skip |= bucket_size == n;
+        }
+        // a pass where every key has the same digit keeps the order
+        if (skip)
+            continue;
+
+        hilbert_run(pool, radix_scatter_job, build);
+        uint32_t* keys = build->keys;
+        build->keys = build->keys_tmp;
+        build->keys_tmp = keys;
+        int* order = build->order;
+        build->order = build->order_tmp;
+        build->order_tmp = order;
+    }
+
+    build->sorted = (Point*)malloc(n * sizeof(Point));
+    hilbert_run(pool, hilbert_gather_job, build);
+
+    free(build->keys);
+    free(build->keys_tmp);
+    free(build->order);
+    free(build->order_tmp);
+    free(build->histograms);
+}
+
+// Función que retorna en cuántos grupos de a lo más B elementos se reparten size elementos consecutivos y guarda en starts
+// dónde empieza cada grupo (con starts[grupos] = size). Los grupos están llenos salvo los dos últimos, que se reparten el
+// resto en partes iguales si el último quedaría con menos de b elementos
+int hilbert_groups(int size, int* starts) {
+    int groups = (size + B - 1) / B;
+    for (int g = 0; g < groups; g++)
+        starts[g] = g * B;
+    starts[groups] = size;
+
+    int last = size - starts[groups - 1];
+    if (groups > 1 && last < b)
+        starts[groups - 1] = starts[groups - 2] + (B + last) / 2;
+    return groups;
+}
+
+// Función que retorna el índice del medoide de los num_entries puntos de node, el de menor excentricidad, contando el radio
+// de cada entrada como en el radio cobertor. Calcula la distancia de cada par una sola vez, como compute_cluster_cache.
+// En las hojas los radios son 0, así que compara las distancias al cuadrado sin calcular sqrt
+int hilbert_medoid(Node* node, int leaf) {
+    int num_entries = node->num_entries;
+    Entry* entries = node->entries;
+    double ecc[num_entries];
+    double distances[num_entries];
+
+    for (int i = 0; i < num_entries; i++)
+        ecc[i] = entries[i].cr;
+    for (int i = 0; i < num_entries; i++) {
+        int later = num_entries - i - 1;
+        squared_distances(&entries[i].p.x, &entries[i + 1].p.x, ENTRY_STRIDE, later, distances);
+        for (int k = 0; k < later; k++) {
+            double d_i = leaf ? distances[k] : sqrt(distances[k]) + entries[i + 1 + k].cr;
+            double d_k = leaf ? distances[k] : sqrt(distances[k]) + entries[i].cr;
+            ecc[i] = d_i > ecc[i] ? d_i : ecc[i];
+            ecc[i + 1 + k] = d_k > ecc[i + 1 + k] ? d_k : ecc[i + 1 + k];
+        }
+    }
+
+    int medoid = 0;
+    for (int i = 1; i < num_entries; i++) {
+        if (ecc[i] < ecc[medoid])
+            medoid = i;
+    }
+    return medoid;
+}
+
+// Función que retorna la mayor distancia entre routing y los count puntos de points
+double hilbert_exact_radius(Point routing, const Point* points, int count) {
+    double distances[HILBERT_RADIUS_CHUNK];
+    double radius = 0.0;
+    for (int k = 0; k < count; k += HILBERT_RADIUS_CHUNK) {
+        int m = intMin(HILBERT_RADIUS_CHUNK, count - k);
+        squared_distances(&routing.x, &points[k].x, POINT_STRIDE, m, distances);
+        for (int t = 0; t < m; t++)
+            radius = distances[t] > radius ? distances[t] : radius;
+    }
+    // sqrt keeps the order, so the root of the largest squared distance is the largest distance
+    return sqrt(radius);
+}
+
+// Función que construye el nodo g de build->level con los elementos del grupo g: puntos si es una hoja y nodos del nivel
+// de abajo si no. Su medoide es el punto de enrutamiento y su radio es la mayor distancia a los puntos de su subárbol
+void hilbert_build_node(HilbertBuild* build, int g) {
+    int start = build->group_starts[g];
+    int size = build->group_starts[g + 1] - start;
+    HilbertLevel* below = build->below;
+    HilbertLevel* level = build->level;
+
+    Node* node = create_node();
+    node->num_entries = size;
+    int first, count;
+    if (below == NULL) {
+        for (int i = 0; i < size; i++) {
+            Entry e = {build->sorted[start + i], 0.0, NULL, 0.0, 1};
+            node->entries[i] = e;
+        }
+        first = start;
+        count = size;
+    }
+    else {
+        for (int i = 0; i < size; i++) {
+            Entry e = {below->routing[start + i], below->radius[start + i], below->nodes[start + i], 0.0, below->count[start + i]};
+            node->entries[i] = e;
+        }
+        first = below->first[start];
+        count = below->first[start + size - 1] + below->count[start + size - 1] - first;
+    }
+
+    Point routing = node->entries[hilbert_medoid(node, below == NULL)].p;
+    set_parent_distances(node, routing);
+
+    // The radius of a leaf is its largest parent distance. Above the leaves the farthest point of the subtree is usually
+    // closer than the bound of the medoid, which adds the radii of the children
+    double radius = 0.0;
+    if (below == NULL) {
+        for (int i = 0; i < size; i++)
+            radius = fmax(radius, node->entries[i].pd);
+    }
+    else {
+        radius = hilbert_exact_radius(routing, build->sorted + first, count);
+    }
+
+    level->nodes[g] = node;
+    level->routing[g] = routing;
+    level->radius[g] = radius;
+    level->first[g] = first;
+    level->count[g] = count;
+}
+
+// Función que ejecuta cada hilo: toma bloques de nodos del nivel actual hasta que no quedan y los construye
+void hilbert_level_job(void* ctx, int worker) {
+    (void)worker;
+    HilbertBuild* build = (HilbertBuild*)ctx;
+    while (1) {
+        int first = atomic_fetch_add(&build->next, HILBERT_NODE_CHUNK);
+        if (first >= build->level->size)
+            break;
+        int last = intMin(first + HILBERT_NODE_CHUNK, build->level->size);
+        for (int g = first; g < last; g++)
+            hilbert_build_node(build, g);
+    }
+}
+
+// Función que reserva un nivel de size nodos
+HilbertLevel* create_hilbert_level(int size) {
+    HilbertLevel* level = (HilbertLevel*)malloc(sizeof(HilbertLevel));
+    level->size = size;
+    level->nodes = (Node**)malloc(size * sizeof(Node*));
+    level->routing = (Point*)malloc(size * sizeof(Point));
+    level->radius = (double*)malloc(size * sizeof(double));
+    level->first = (int*)malloc(size * sizeof(int));
+    level->count = (int*)malloc(size * sizeof(int));
+    return level;
+}
+
+// Función que libera un nivel, sin sus nodos
+void free_hilbert_level(HilbertLevel* level) {
+    free(level->nodes);
+    free(level->routing);
+    free(level->radius);
+    free(level->first);
+    free(level->count);
+    free(level);
+}
+
+// Función que construye con los hilos de pool (o en este hilo si pool es NULL) un M-tree de los P_size puntos de P ordenándolos
+// por su posición en una curva de Hilbert sobre el rectángulo que los contiene. Las hojas son grupos de B puntos consecutivos
+// en la curva y cada nivel superior agrupa B nodos consecutivos del nivel de abajo, hasta que queda uno, la raíz. Cada nodo
+// usa su medoide como punto de enrutamiento y su radio cobertor es exacto. Toma O(n log n) y no usa números aleatorios
+Node* hilbertBulkLoadParallel(Point* P, int P_size, ThreadPool* pool) {
+    if (P_size == 0)
+        return create_node();
+
+    HilbertBuild build;
+    memset(&build, 0, sizeof(build));
+    build.P = P;
+    build.n = P_size;
+    build.num_threads = pool != NULL ? pool->num_threads : 1;
+
+    Point high = P[0];
+    build.low = P[0];
+    for (int i = 1; i < P_size; i++) {
+        build.low.x = fmin(build.low.x, P[i].x);
+        build.low.y = fmin(build.low.y, P[i].y);
+        high.x = fmax(high.x, P[i].x);
+        high.y = fmax(high.y, P[i].y);
+    }
+    // the same scale for both axes keeps the cells square
+    double extent = fmax(high.x - build.low.x, high.y - build.low.y);
+    build.scale = extent > 0.0 ? (1u << HILBERT_ORDER) / extent : 0.0;
+
+    hilbert_sort(&build, pool);
+
+    // every level has at most one group per B elements of the one below, plus the end of the last group
+    build.group_starts = (int*)malloc(((P_size + B - 1) / B + 1) * sizeof(int));
+    int size = P_size;
+    HilbertLevel* below = NULL;
+    do {
+        int groups = hilbert_groups(size, build.group_starts);
+        build.below = below;
+        build.level = create_hilbert_level(groups);
+        atomic_init(&build.next, 0);
+        hilbert_run(pool, hilbert_level_job, &build);
+
+        if (below != NULL)
+            free_hilbert_level(below);
+        below = build.level;
+        size = groups;
+    } while (size > 1);
+
+    Node* root = below->nodes[0];
+    free_hilbert_level(below);
+    free(build.group_starts);
+    free(build.sorted);
+    return root;
+}
+
+// Función que construye en este hilo el mismo árbol que hilbertBulkLoadParallel
+Node* hilbertBulkLoad(Point* P, int P_size) {
+    return hilbertBulkLoadParallel(P, P_size, NULL);
+}
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef INSERT_C
+#define INSERT_C
+
+#include "mtree.c"
+
+// Políticas para elegir los dos puntos que se promueven al dividir un nodo lleno
+typedef enum {
+    PROMOTE_RANDOM, // two random entries
+    PROMOTE_M_RAD, // the pair whose partition has the smallest maximum covering radius (mM_RAD)
+    PROMOTE_M_LB_DIST // the parent routing object and the entry farthest from it
+} PromotePolicy;
+
+// Políticas para repartir las entradas de un nodo entre los dos puntos promovidos
+typedef enum {
+    PARTITION_HYPERPLANE, // every entry goes to its nearest promoted point
+    PARTITION_BALANCED // the promoted points take their nearest free entry by turns, so both halves have the same size
+} PartitionPolicy;
+
+// Estructura con las políticas que usa mtree_insert para dividir nodos
+typedef struct {
+    PromotePolicy promote;
+    PartitionPolicy partition;
+    unsigned int seed; // random state of PROMOTE_RANDOM
+} InsertPolicy;
+
+// Políticas usadas por mtree_insert. PARTITION_HYPERPLANE da radios más chicos, pero solo con PARTITION_BALANCED
+// cada mitad de un nodo dividido tiene al menos b entradas
+InsertPolicy insert_policy = {PROMOTE_M_LB_DIST, PARTITION_HYPERPLANE, 1};
+
+// Estructura que representa una entrada del nodo que se divide y su distancia a un punto promovido
+typedef struct {
+    double dist;
+    int index;
+} RankedEntry;
+
+// Estructura con las entradas de un nodo que se divide, sus distancias y la partición elegida
+typedef struct {
+    Entry* entries;
+    int n;
+    double* dist; // row i: distance from entry i to every entry
+    RankedEntry* ranked; // row i: every entry sorted by distance to entry i, filled when ranked_rows[i] is 1
+    char* ranked_rows;
+    signed char* side; // half of each entry: 0 for the first promoted point, 1 for the second
+} SplitEntries;
+
+// Función que ordena dos entradas por distancia y luego por índice
+int compare_ranked_entries(const void* a, const void* b2) {
+    const RankedEntry* x = (const RankedEntry*)a;
+    const RankedEntry* y = (const RankedEntry*)b2;
+    if (x->dist != y->dist)
+        return x->dist < y->dist ? -1 : 1;
+    return x->index - y->index;
+}
+
+// Función que retorna la fila i de entradas ordenadas por distancia a la entrada i, ordenándola la primera vez
+RankedEntry* ranked_row(SplitEntries* split, int i) {
+    RankedEntry* row = split->ranked + (size_t)i * split->n;
+    if (!split->ranked_rows[i]) {
+        for (int k = 0; k < split->n; k++) {
+            row[k].dist = split->dist[(size_t)i * split->n + k];
+            row[k].index = k;
+        }
+        qsort(row, split->n, sizeof(RankedEntry), compare_ranked_entries);
+        split->ranked_rows[i] = 1;
+    }
+    return row;
+}
+
+// Función que reparte las entradas entre los puntos promovidos o1 y o2 según insert_policy.partition, dejando la mitad de
+// cada una en split->side. Retorna el mayor de los dos radios cobertores, donde el radio de una mitad es la mayor distancia
+// de su punto promovido a una entrada más el radio de esa entrada
+double partition_entries(SplitEntries* split, int o1, int o2, double radius[2]) {
+    int n = split->n;
+    double* d1 = split->dist + (size_t)o1 * n;
+    double* d2 = split->dist + (size_t)o2 * n;
+    radius[0] = 0.0;
+    radius[1] = 0.0;
+
+    if (insert_policy.partition == PARTITION_HYPERPLANE) {
+        for (int k = 0; k < n; k++)
+            split->side[k] = (k == o2 || (k != o1 && d2[k] < d1[k])) ? 1 : 0;
+    }
+    else {
+        RankedEntry* row1 = ranked_row(split, o1);
+        RankedEntry* row2 = ranked_row(split, o2);
+        int next1 = 0, next2 = 0;
+        memset(split->side, -1, n);
+        split->side[o1] = 0;
+        split->side[o2] = 1;
+        for (int taken = 2; taken < n; taken++) {
+            if (taken % 2 == 0) {
+                while (split->side[row1[next1].index] != -1)
+                    next1++;
+                split->side[row1[next1].index] = 0;
+            }
+            else {
+                while (split->side[row2[next2].index] != -1)
+                    next2++;
+                split->side[row2[next2].index] = 1;
+            }
+        }
+    }
+
+    for (int k = 0; k < n; k++) {
+        int s = split->side[k];
+        double reach = (s == 0 ? d1[k] : d2[k]) + split->entries[k].cr;
+        if (reach > radius[s])
+            radius[s] = reach;
+    }
+    return radius[0] > radius[1] ? radius[0] : radius[1];
+}
+
+// Función que retorna la entrada más lejana a la entrada i
+int farthest_entry(SplitEntries* split, int i) {
+    int farthest = i == 0 ? 1 : 0;
+    for (int k = 0; k < split->n; k++) {
+        if (split->dist[(size_t)i * split->n + k] > split->dist[(size_t)i * split->n + farthest])
+            farthest = k;
+    }
+    return farthest;
+}
+
+// Función que elige los puntos promovidos o1 y o2 según insert_policy.promote. parent es el punto de la entrada que apunta
+// al nodo que se divide, NULL si es la raíz
+void promote_entries(SplitEntries* split, const Point* parent, int* o1, int* o2) {
+    int n = split->n;
+    double radius[2];
+
+    if (insert_policy.promote == PROMOTE_RANDOM) {
+        *o1 = rand_r(&insert_policy.seed) % n;
+        *o2 = rand_r(&insert_policy.seed) % (n - 1);
+        if (*o2 >= *o1)
+            (*o2)++;
+    }
+    else if (insert_policy.promote == PROMOTE_M_RAD) {
+        double best = DBL_MAX;
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                double r = partition_entries(split, i, j, radius);
+                if (r < best) {
+                    best = r;
+                    *o1 = i;
+                    *o2 = j;
+                }
+            }
+        }
+    }
+    else {
+        // the parent routing object is usually one of the entries; the root has none, so it starts from a far entry
+        if (parent != NULL) {
+            *o1 = 0;
+            for (int k = 1; k < n; k++) {
+                if (squared_distance(*parent, split->entries[k].p) < squared_distance(*parent, split->entries[*o1].p))
+                    *o1 = k;
+            }
+        }
+        else {
+            *o1 = farthest_entry(split, 0);
+        }
+        *o2 = farthest_entry(split, *o1);
+    }
+}
+
+// Función que divide las n entradas de entries (n > B) entre node y un nodo nuevo, guardando en promoted las entradas
+// que apuntan a cada uno. parent es el punto de la entrada que apunta a node, NULL si es la raíz
+void split_node(Node* node, Entry* entries, int n, const Point* parent, Entry promoted[2]) {
+    SplitEntries split;
+    split.entries = entries;
+    split.n = n;
+    split.dist = (double*)malloc((size_t)n * n * sizeof(double));
+    split.ranked = (RankedEntry*)malloc((size_t)n * n * sizeof(RankedEntry));
+    split.ranked_rows = (char*)calloc(n, 1);
+    split.side = (signed char*)malloc(n);
+
+    squared_distance_matrix(&entries[0].p.x, ENTRY_STRIDE, n, &entries[0].p.x, ENTRY_STRIDE, n, split.dist);
+    for (size_t k = 0; k < (size_t)n * n; k++)
+        split.dist[k] = sqrt(split.dist[k]);
+
+    int o1, o2;
+    double radius[2];
+    promote_entries(&split, parent, &o1, &o2);
+    partition_entries(&split, o1, o2, radius);
+
+    Node* sibling = create_node();
+    node->num_entries = 0;
+    for (int k = 0; k < n; k++) {
+        Node* half = split.side[k] == 0 ? node : sibling;
+        entries[k].pd = split.side[k] == 0 ? split.dist[(size_t)o1 * n + k] : split.dist[(size_t)o2 * n + k];
+        half->entries[half->num_entries++] = entries[k];
+    }
+
+    // their distance to the parent is set by the caller, which adds them to the parent node
+    Entry first = {entries[o1].p, radius[0], node, 0.0, subtree_count(node)};
+    Entry second = {entries[o2].p, radius[1], sibling, 0.0, subtree_count(sibling)};
+    promoted[0] = first;
+    promoted[1] = second;
+
+    free(split.dist);
+    free(split.ranked);
+    free(split.ranked_rows);
+    free(split.side);
+}
+
+// Función que deja espacio para B entradas en node. Los nodos de SS se crean con el espacio justo para sus entradas
+void reserve_node_entries(Node* node) {
+    if (node->capacity >= B)
+        return;
+    if (node->entries == (Entry*)(node + 1)) {
+        // entries stored right after the node in an arena can not be resized
+        Entry* entries = node_arena != NULL ? (Entry*)arena_alloc(node_arena, B * sizeof(Entry)) : (Entry*)malloc(B * sizeof(Entry));
+        memcpy(entries, node->entries, node->num_entries * sizeof(Entry));
+        node->entries = entries;
+    }
+    else {
+        node->entries = (Entry*)realloc(node->entries, B * sizeof(Entry));
+    }
+    node->capacity = B;
+}
+
+// Función que agrega entry a node, dividiéndolo si ya tiene B entradas. Retorna 1 si lo dividió, y en ese caso deja en
+// promoted las entradas que reemplazan a la que apuntaba a node
+int add_entry_to_node(Node* node, const Point* parent, Entry entry, Entry promoted[2]) {
+    entry.pd = parent != NULL ? euclidean_distance(*parent, entry.p) : 0.0;
+    if (node->num_entries < B) {
+        reserve_node_entries(node);
+        node->entries[node->num_entries++] = entry;
+        return 0;
+    }
+
+    Entry entries[B + 1];
+    memcpy(entries, node->entries, node->num_entries * sizeof(Entry));
+    entries[node->num_entries] = entry;
+    split_node(node, entries, node->num_entries + 1, parent, promoted);
+    return 1;
+}
+
+// Función que elige la entrada de node (con hijo) donde insertar p: la más cercana entre las que ya cubren p,
+// o si ninguna lo cubre, la que menos debe aumentar su radio cobertor
+int choose_subtree(Node* node, Point p) {
+    int chosen = -1;
+    int covered = 0;
+    double best = DBL_MAX;
+    for (int i = 0; i < node->num_entries; i++) {
+        Entry e = node->entries[i];
+        if (e.a == NULL)
+            continue;
+        double d = euclidean_distance(e.p, p);
+        if (d <= e.cr) {
+            if (!covered || d < best) {
+                covered = 1;
+                best = d;
+                chosen = i;
+            }
+        }
+        else if (!covered && d - e.cr < best) {
+            best = d - e.cr;
+            chosen = i;
+        }
+    }
+    return chosen;
+}
+
+// Función que inserta entry en el subárbol node. Retorna 1 si node se dividió, dejando en promoted sus dos reemplazos
+int insert_entry_in_subtree(Node* node, const Point* parent, Entry entry, Entry promoted[2]) {
+    int chosen = choose_subtree(node, entry.p);
+
+    // leaves (and empty nodes) store the entry directly
+    if (chosen == -1)
+        return add_entry_to_node(node, parent, entry, promoted);
+
+    Entry* e = &node->entries[chosen];
+    Point routing = e->p;
+    double d = euclidean_distance(routing, entry.p);
+    Entry child_promoted[2];
+
+    if (!insert_entry_in_subtree(e->a, &routing, entry, child_promoted)) {
+        // the routing entry must keep covering the new entry
+        if (d + entry.cr > e->cr)
+            e->cr = d + entry.cr;
+        e->count += entry.count;
+        return 0;
+    }
+
+    // the child was split: its entry is replaced by the first half and the second half is added
+    child_promoted[0].pd = parent != NULL ? euclidean_distance(*parent, child_promoted[0].p) : 0.0;
+    node->entries[chosen] = child_promoted[0];
+    return add_entry_to_node(node, parent, child_promoted[1], promoted);
+}
+
+// Función que inserta el punto p en el árbol root, dividiendo los nodos que se llenan según insert_policy y manteniendo
+// válidos los radios cobertores. La raíz conserva su dirección: si se divide, sus entradas pasan a un nodo nuevo.
+// Si el árbol se construyó en un arena, node_arena debe seguir apuntando a ese arena al insertar
+void mtree_insert(Node* root, Point p) {
+    Entry entry = {p, 0.0, NULL, 0.0, 1};
+    Entry promoted[2];
+
+    if (insert_entry_in_subtree(root, NULL, entry, promoted)) {
+        Node* moved = create_node();
+        memcpy(moved->entries, root->entries, root->num_entries * sizeof(Entry));
+        moved->num_entries = root->num_entries;
+        promoted[0].a = moved;
+        root->entries[0] = promoted[0];
+        root->entries[1] = promoted[1];
+        root->num_entries = 2;
+    }
+}
+
+#endif
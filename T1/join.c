@@ -0,0 +1,307 @@
+#ifndef JOIN_C
+#define JOIN_C
+
+#include <stdatomic.h>
+
+#include "mtree.c"
+#include "threadpool.c"
+
+// Cantidad de pares de nodos por hilo que busca juntar parallel_similarity_join antes de repartirlos
+#define JOIN_TASKS_PER_THREAD 64
+
+typedef struct joinnode JoinNode;
+typedef struct jointask JoinTask;
+typedef struct jointasks JoinTasks;
+
+// Función que recibe cada par de puntos a distancia a lo más eps junto al contexto ctx del que hace el join.
+// Si retorna distinto de 0 el join se detiene
+typedef int (*PairVisitor)(Point p1, Point p2, void* ctx);
+
+// Estructura que representa un nodo durante un join: el nodo, el punto de la entrada que lo apunta y su radio cobertor.
+// La raíz no tiene entrada, así que su radio es INFINITY
+struct joinnode {
+    Node* node;
+    Point routing;
+    double radius;
+};
+
+// Estructura que representa un par de nodos pendiente de un join. Si self es 1 los dos nodos son el mismo y se buscan
+// los pares dentro de su subárbol, cada uno una sola vez
+struct jointask {
+    JoinNode n1, n2;
+    int self;
+};
+
+// Estructura que representa un arreglo de tareas de join que crece duplicando su capacidad
+struct jointasks {
+    JoinTask* tasks;
+    int size;
+    int capacity;
+};
+
+// Función que retorna el nodo del join al que apunta la entrada e
+JoinNode join_child(Entry* e) {
+    JoinNode child = {e->a, e->p, e->cr};
+    return child;
+}
+
+// Función que agrega una tarea al final de tasks
+void push_join_task(JoinTasks* tasks, JoinTask task) {
+    if (tasks->size == tasks->capacity) {
+        tasks->capacity = tasks->capacity == 0 ? 64 : 2 * tasks->capacity;
+        tasks->tasks = (JoinTask*)realloc(tasks->tasks, tasks->capacity * sizeof(JoinTask));
+    }
+    tasks->tasks[tasks->size++] = task;
+}
+
+// Función que resuelve o divide el par de nodos task. Si children es NULL busca sus pares recursivamente y los entrega a visit;
+// si no, agrega a children los pares de hijos que hay que revisar, salvo que los dos nodos sean hojas. Los pares de subárboles
+// cuyas bolas están a más de eps se descartan, primero con la distancia de cada entrada a su padre y luego con la distancia
+// entre sus puntos. Guarda en pairs la cantidad de pares encontrados y retorna 1 si visit detuvo el join
+int join_pair(JoinTask* task, double eps, PairVisitor visit, void* ctx, long* pairs, int* disk_accesses, JoinTasks* children);
+
+// Función que busca los pares a distancia a lo más eps entre puntos distintos del subárbol de un solo nodo
+int self_join_node(JoinNode* n, double eps, PairVisitor visit, void* ctx, long* pairs, int* disk_accesses, JoinTasks* children) {
+    Node* node = n->node;
+    int num_entries = node->num_entries;
+    Entry* entries = node->entries;
+    int leaf = is_leaf(node);
+
+    (*disk_accesses)++;
+
+    double distances[num_entries + 1];
+    for (int i = 0; i < num_entries; i++) {
+        int later = num_entries - i - 1;
+        squared_distances(&entries[i].p.x, &entries[i + 1].p.x, ENTRY_STRIDE, later, distances);
+        distance_computations += later;
+
+        for (int k = 0; k < later; k++) {
+            int j = i + 1 + k;
+            // internal entries are compared without squaring, as in range_search_from
+            if (leaf ? distances[k] > eps * eps : sqrt(distances[k]) > entries[i].cr + entries[j].cr + eps)
+                continue;
+            if (leaf) {
+                (*pairs)++;
+                if (visit(entries[i].p, entries[j].p, ctx))
+                    return 1;
+            }
+            else {
+                JoinTask task = {join_child(&entries[i]), join_child(&entries[j]), 0};
+                if (children != NULL)
+                    push_join_task(children, task);
+                else if (join_pair(&task, eps, visit, ctx, pairs, disk_accesses, NULL))
+                    return 1;
+            }
+        }
+    }
+
+    if (!leaf) {
+        for (int i = 0; i < num_entries; i++) {
+            JoinTask task = {join_child(&entries[i]), join_child(&entries[i]), 1};
+            if (children != NULL)
+                push_join_task(children, task);
+            else if (join_pair(&task, eps, visit, ctx, pairs, disk_accesses, NULL))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+int join_pair(JoinTask* task, double eps, PairVisitor visit, void* ctx, long* pairs, int* disk_accesses, JoinTasks* children) {
+    if (task->self)
+        return self_join_node(&task->n1, eps, visit, ctx, pairs, disk_accesses, children);
+
+    JoinNode* n1 = &task->n1;
+    JoinNode* n2 = &task->n2;
+    int leaf1 = is_leaf(n1->node);
+    int leaf2 = is_leaf(n2->node);
+    if (leaf1 && leaf2 && children != NULL) {
+        push_join_task(children, *task);
+        return 0;
+    }
+    (*disk_accesses) += 2;
+
+    // The trees can have different heights: the deeper one is descended alone until both reach their leaves.
+    // Only the children whose ball reaches the ball of the other node within eps are visited
+    if (leaf1 != leaf2) {
+        JoinNode* inner = leaf1 ? n2 : n1;
+        JoinNode* outer = leaf1 ? n1 : n2;
+        Entry* entries = inner->node->entries;
+        int num_entries = inner->node->num_entries;
+        double distances[num_entries + 1];
+        int bounded = isfinite(outer->radius);
+        if (bounded) {
+            squared_distances(&outer->routing.x, &entries[0].p.x, ENTRY_STRIDE, num_entries, distances);
+            distance_computations += num_entries;
+        }
+        for (int i = 0; i < num_entries; i++) {
+            if (bounded && sqrt(distances[i]) > outer->radius + entries[i].cr + eps)
+                continue;
+            JoinTask child = leaf1 ? (JoinTask){*outer, join_child(&entries[i]), 0} : (JoinTask){join_child(&entries[i]), *outer, 0};
+            if (children != NULL)
+                push_join_task(children, child);
+            else if (join_pair(&child, eps, visit, ctx, pairs, disk_accesses, NULL))
+                return 1;
+        }
+        return 0;
+    }
+
+    Entry* entries1 = n1->node->entries;
+    Entry* entries2 = n2->node->entries;
+    int num1 = n1->node->num_entries;
+    int num2 = n2->node->num_entries;
+
+    // d(p1, routing2) >= |d(routing1, routing2) - d(p1, routing1)|, so with the distance between the routing points the
+    // entries that cannot reach the ball of the other node are discarded without their distance, as in range_search_from
+    int rows[num1 + 1];
+    int cols[num2 + 1];
+    int num_rows = 0;
+    int num_cols = 0;
+    if (isfinite(n1->radius) && isfinite(n2->radius) && parent_distance_pruning) {
+        double routing_distance = euclidean_distance(n1->routing, n2->routing);
+        distance_computations++;
+        for (int i = 0; i < num1; i++) {
+            rows[num_rows] = i;
+            num_rows += fabs(routing_distance - entries1[i].pd) <= entries1[i].cr + n2->radius + eps;
+        }
+        for (int j = 0; j < num2; j++) {
+            cols[num_cols] = j;
+            num_cols += fabs(routing_distance - entries2[j].pd) <= entries2[j].cr + n1->radius + eps;
+        }
+        distance_computations_saved += (long)num1 * num2 - (long)num_rows * num_cols;
+    }
+    else {
+        for (int i = 0; i < num1; i++)
+            rows[num_rows++] = i;
+        for (int j = 0; j < num2; j++)
+            cols[num_cols++] = j;
+    }
+
+    double distances[num2 + 1];
+    for (int r = 0; r < num_rows; r++) {
+        Entry* e1 = &entries1[rows[r]];
+        if (num_cols == num2) {
+            squared_distances(&e1->p.x, &entries2[0].p.x, ENTRY_STRIDE, num2, distances);
+        }
+        else {
+            for (int c = 0; c < num_cols; c++)
+                distances[cols[c]] = squared_distance(e1->p, entries2[cols[c]].p);
+        }
+        distance_computations += num_cols;
+
+        for (int c = 0; c < num_cols; c++) {
+            Entry* e2 = &entries2[cols[c]];
+            if (leaf1 ? distances[cols[c]] > eps * eps : sqrt(distances[cols[c]]) > e1->cr + e2->cr + eps)
+                continue;
+            if (leaf1) {
+                (*pairs)++;
+                if (visit(e1->p, e2->p, ctx))
+                    return 1;
+            }
+            else {
+                JoinTask child = {join_child(e1), join_child(e2), 0};
+                if (children != NULL)
+                    push_join_task(children, child);
+                else if (join_pair(&child, eps, visit, ctx, pairs, disk_accesses, NULL))
+                    return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Función que entrega a visit cada par (p1, p2) con p1 en el árbol t1, p2 en el árbol t2 y distancia entre ellos a lo más eps,
+// recorriendo los dos árboles a la vez. Guarda los nodos leídos en disk_accesses y retorna la cantidad de pares entregados
+long similarity_join(Node* t1, Node* t2, double eps, PairVisitor visit, void* ctx, int* disk_accesses) {
+    JoinTask task = {{t1, {0.0, 0.0}, INFINITY}, {t2, {0.0, 0.0}, INFINITY}, 0};
+    long pairs = 0;
+    join_pair(&task, eps, visit, ctx, &pairs, disk_accesses, NULL);
+    return pairs;
+}
+
+// Función que entrega a visit cada par de puntos del árbol tree a distancia a lo más eps, una sola vez y sin juntar un punto
+// consigo mismo (dos puntos iguales en entradas distintas sí forman un par). Retorna la cantidad de pares entregados
+long self_similarity_join(Node* tree, double eps, PairVisitor visit, void* ctx, int* disk_accesses) {
+    JoinTask task = {{tree, {0.0, 0.0}, INFINITY}, {tree, {0.0, 0.0}, INFINITY}, 1};
+    long pairs = 0;
+    join_pair(&task, eps, visit, ctx, &pairs, disk_accesses, NULL);
+    return pairs;
+}
+
+// Estructura con el trabajo compartido por los hilos de parallel_similarity_join
+typedef struct {
+    JoinTasks frontier;
+    double eps;
+    PairVisitor visit;
+    void** worker_ctx;
+    atomic_int next; // first task not taken yet
+    atomic_int stop; // set when a visit stops the join
+    long* worker_pairs;
+    int* worker_accesses;
+} ParallelJoin;
+
+// Función que ejecuta cada hilo: toma pares de nodos de la frontera hasta que no quedan y los resuelve con su propio contexto
+void parallel_join_job(void* ctx, int worker) {
+    ParallelJoin* join = (ParallelJoin*)ctx;
+    long pairs = 0;
+    int accesses = 0;
+
+    while (!atomic_load(&join->stop)) {
+        int t = atomic_fetch_add(&join->next, 1);
+        if (t >= join->frontier.size)
+            break;
+        if (join_pair(&join->frontier.tasks[t], join->eps, join->visit, join->worker_ctx[worker], &pairs, &accesses, NULL))
+            atomic_store(&join->stop, 1);
+    }
+
+    join->worker_pairs[worker] = pairs;
+    join->worker_accesses[worker] = accesses;
+}
+
+// Función que hace el join de t1 y t2 (o de t1 consigo mismo si t2 es NULL) con los hilos de pool. Divide los pares de nodos
+// desde las raíces, un nivel a la vez, hasta tener JOIN_TASKS_PER_THREAD pares por hilo o llegar a las hojas, y los hilos se
+// reparten esa frontera. El hilo w entrega sus pares a visit con el contexto worker_ctx[w], así que visit no necesita
+// sincronizarse si cada hilo tiene su propio contexto. Retorna la cantidad de pares entregados
+long parallel_similarity_join(ThreadPool* pool, Node* t1, Node* t2, double eps, PairVisitor visit, void** worker_ctx, int* disk_accesses) {
+    ParallelJoin join;
+    memset(&join, 0, sizeof(join));
+    join.eps = eps;
+    join.visit = visit;
+    join.worker_ctx = worker_ctx;
+    atomic_init(&join.next, 0);
+    atomic_init(&join.stop, 0);
+
+    JoinTask root = {{t1, {0.0, 0.0}, INFINITY}, {t2 != NULL ? t2 : t1, {0.0, 0.0}, INFINITY}, t2 == NULL};
+    push_join_task(&join.frontier, root);
+
+    // Splitting a pair of leaves leaves it as it is, so the frontier stops growing once every pair is a pair of leaves
+    long pairs = 0;
+    int target = JOIN_TASKS_PER_THREAD * pool->num_threads;
+    int grew = 1;
+    while (join.frontier.size < target && grew) {
+        JoinTasks next = {NULL, 0, 0};
+        // pairs inside a single leaf are found here, by the thread that becomes worker 0
+        for (int t = 0; t < join.frontier.size && !atomic_load(&join.stop); t++) {
+            if (join_pair(&join.frontier.tasks[t], eps, visit, worker_ctx[0], &pairs, disk_accesses, &next))
+                atomic_store(&join.stop, 1);
+        }
+        grew = next.size != join.frontier.size;
+        free(join.frontier.tasks);
+        join.frontier = next;
+    }
+
+    join.worker_pairs = (long*)calloc(pool->num_threads, sizeof(long));
+    join.worker_accesses = (int*)calloc(pool->num_threads, sizeof(int));
+    thread_pool_run(pool, parallel_join_job, &join);
+
+    for (int i = 0; i < pool->num_threads; i++) {
+        pairs += join.worker_pairs[i];
+        *disk_accesses += join.worker_accesses[i];
+    }
+    free(join.worker_pairs);
+    free(join.worker_accesses);
+    free(join.frontier.tasks);
+    return pairs;
+}
+
+#endif
@@ -0,0 +1,294 @@
+#include <getopt.h>
+
+#include "ss.c"
+#include "parallel.c"
+#include "hilbert.c"
+#include "stats.c"
+
+// Constructores que puede medir el benchmark
+#define BENCH_CP 1
+#define BENCH_SS 2
+#define BENCH_HILBERT 4
+#define BENCH_ALL (BENCH_CP | BENCH_SS | BENCH_HILBERT)
+
+typedef struct benchoptions BenchOptions;
+typedef struct benchresult BenchResult;
+
+// Estructura con las opciones del benchmark, que se leen de la línea de comandos
+struct benchoptions {
+    int min_exp, max_exp; // sets of 2^min_exp to 2^max_exp points
+    int queries;
+    double radius;
+    uint64_t seed;
+    int builders; // BENCH_CP, BENCH_SS and BENCH_HILBERT bits
+    int threads;
+    int json;
+    const char* output; // NULL writes to stdout
+};
+
+// Estructura con las mediciones de un constructor sobre un conjunto de puntos
+struct benchresult {
+    const char* builder;
+    int n;
+    double build_seconds;
+    int height;
+    int nodes;
+    double leaf_fill; // mean entries of the leaves over B
+    double sibling_overlap; // fraction of sibling balls that intersect
+    size_t memory_bytes;
+    double accesses; // per query
+    double distances; // per query
+    double results; // per query
+    double p50, p90, p99, max_latency; // microseconds
+    double queries_per_second; // with every thread of the pool, or one at a time without pool
+};
+
+// Función que muestra cómo se usa el benchmark
+void bench_usage(const char* program) {
+    printf("Uso: %s [opciones]\n", program);
+    printf("  -n, --min-exp K     conjunto más chico de 2^K puntos (10)\n");
+    printf("  -N, --max-exp K     conjunto más grande de 2^K puntos (igual a --min-exp)\n");
+    printf("  -q, --queries Q     cantidad de consultas (100)\n");
+    printf("  -r, --radius R      radio de las consultas (0.02)\n");
+    printf("  -s, --seed S        semilla de los puntos, consultas y Ciaccia-Patella (2024)\n");
+    printf("  -b, --builder B     cp, ss, hilbert o all (all)\n");
+    printf("  -t, --threads T     hilos de construcción y consultas (1)\n");
+    printf("  -f, --format F      csv o json (csv)\n");
+    printf("  -o, --output PATH   archivo de resultados (salida estándar)\n");
+}
+
+// Función que lee las opciones de la línea de comandos. Termina el programa si alguna no es válida
+BenchOptions parse_bench_options(int argc, char** argv) {
+    BenchOptions options = {10, -1, 100, 0.02, 2024, BENCH_ALL, 1, 0, NULL};
+    struct option long_options[] = {
+        {"min-exp", required_argument, NULL, 'n'},
+        {"max-exp", required_argument, NULL, 'N'},
+        {"queries", required_argument, NULL, 'q'},
+        {"radius", required_argument, NULL, 'r'},
+        {"seed", required_argument, NULL, 's'},
+        {"builder", required_argument, NULL, 'b'},
+        {"threads", required_argument, NULL, 't'},
+        {"format", required_argument, NULL, 'f'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:N:q:r:s:b:t:f:o:h", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'n': options.min_exp = atoi(optarg); break;
+            case 'N': options.max_exp = atoi(optarg); break;
+            case 'q': options.queries = atoi(optarg); break;
+            case 'r': options.radius = atof(optarg); break;
+            case 's': options.seed = strtoull(optarg, NULL, 10); break;
+            case 't': options.threads = atoi(optarg); break;
+            case 'o': options.output = optarg; break;
+            case 'b':
+                if (strcmp(optarg, "cp") == 0)
+                    options.builders = BENCH_CP;
+                else if (strcmp(optarg, "ss") == 0)
+                    options.builders = BENCH_SS;
+                else if (strcmp(optarg, "hilbert") == 0)
+                    options.builders = BENCH_HILBERT;
+                else if (strcmp(optarg, "all") == 0)
+                    options.builders = BENCH_ALL;
+                else
+                    options.builders = 0;
+                break;
+            case 'f':
+                if (strcmp(optarg, "csv") == 0)
+                    options.json = 0;
+                else if (strcmp(optarg, "json") == 0)
+                    options.json = 1;
+                else
+                    options.json = -1;
+                break;
+            case 'h':
+                bench_usage(argv[0]);
+                exit(0);
+            default:
+                bench_usage(argv[0]);
+                exit(1);
+        }
+    }
+    if (options.max_exp < 0)
+        options.max_exp = options.min_exp;
+
+    // sets are indexed with an int, so they have at most 2^30 points
+    if (optind < argc || options.min_exp < 1 || options.max_exp < options.min_exp || options.max_exp > 30 ||
+        options.queries < 1 || options.radius < 0.0 || options.builders == 0 || options.threads < 1 || options.json < 0) {
+        printf("Opciones no válidas.\n");
+        bench_usage(argv[0]);
+        exit(1);
+    }
+    return options;
+}
+
+// Función que compara dos doubles, usada por qsort para ordenar las latencias
+int compare_latencies(const void* a, const void* b2) {
+    double x = *(const double*)a;
+    double y = *(const double*)b2;
+    return (x > y) - (x < y);
+}
+
+// Función que retorna el percentil p (entre 0 y 1) de los size valores ordenados de sorted, por el método del rango más cercano
+double percentile(double* sorted, int size, double p) {
+    int rank = (int)ceil(p * size);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// Función que construye con builder un árbol de los n puntos de P y mide sus consultas Qs, una a la vez para las
+// latencias y con todos los hilos de pool para el throughput
+BenchResult run_bench(int builder, Point* P, int n, Query* Qs, BenchOptions* options, ThreadPool* pool) {
+    BenchResult result;
+    memset(&result, 0, sizeof(result));
+    result.builder = builder == BENCH_CP ? "cp" : builder == BENCH_SS ? "ss" : "hilbert";
+    result.n = n;
+
+    // Los nodos del árbol se guardan en un arena, y se liberan todos juntos al terminar con el árbol
+    node_arena = create_arena(ARENA_BLOCK_SIZE, 1);
+    double start = wall_seconds();
+    Node* tree;
+    if (builder == BENCH_CP) {
+        if (pool != NULL)
+            tree = ciacciaPatellaParallel(P, n, (unsigned int)options->seed, pool);
+        else
+            tree = ciacciaPatellaSeeded(P, n, (unsigned int)options->seed);
+    }
+    else if (builder == BENCH_SS) {
+        split_pool = pool;
+        tree = sextonSwinbank(P, n);
+        split_pool = NULL;
+    }
+    else {
+        tree = hilbertBulkLoadParallel(P, n, pool);
+    }
+    result.build_seconds = wall_seconds() - start;
+    TreeStats* stats = mtree_stats(tree);
+    result.height = stats->height;
+    result.nodes = stats->nodes;
+    result.leaf_fill = (double)stats->points / stats->leaves / stats->node_capacity;
+    result.sibling_overlap = stats->sibling_pairs > 0 ? (double)stats->overlapping_pairs / stats->sibling_pairs : 0.0;
+    result.memory_bytes = stats->memory_bytes;
+    free_tree_stats(stats);
+
+    double* latencies = (double*)malloc(options->queries * sizeof(double));
+    int accesses = 0;
+    long results = 0;
+    long distances_before = distance_computations;
+    double queries_start = wall_seconds();
+    for (int j = 0; j < options->queries; j++) {
+        int search_size;
+        double query_start = wall_seconds();
+        Point* search = search_points_in_radio(tree, Qs[j], &search_size, &accesses);
+        latencies[j] = (wall_seconds() - query_start) * 1e6;
+        results += search_size;
+        free(search);
+    }
+    double queries_seconds = wall_seconds() - queries_start;
+    result.accesses = (double)accesses / options->queries;
+    result.distances = (double)(distance_computations - distances_before) / options->queries;
+    result.results = (double)results / options->queries;
+
+    qsort(latencies, options->queries, sizeof(double), compare_latencies);
+    result.p50 = percentile(latencies, options->queries, 0.50);
+    result.p90 = percentile(latencies, options->queries, 0.90);
+    result.p99 = percentile(latencies, options->queries, 0.99);
+    result.max_latency = latencies[options->queries - 1];
+    free(latencies);
+
+    if (pool != NULL) {
+        QueryResult* parallel_results = (QueryResult*)malloc(options->queries * sizeof(QueryResult));
+        int parallel_accesses = 0;
+        start = wall_seconds();
+        parallel_search_points_in_radio(pool, tree, Qs, options->queries, parallel_results, &parallel_accesses);
+        result.queries_per_second = options->queries / (wall_seconds() - start);
+        for (int j = 0; j < options->queries; j++)
+            free(parallel_results[j].points);
+        free(parallel_results);
+    }
+    else {
+        result.queries_per_second = options->queries / queries_seconds;
+    }
+
+    destroy_arena(node_arena);
+    node_arena = NULL;
+    return result;
+}
+
+// Función que escribe en out una fila CSV, o un objeto JSON, con el resultado r. first indica si es el primer resultado
+void print_bench_result(FILE* out, BenchResult* r, BenchOptions* options, int first) {
+    if (options->json) {
+        fprintf(out, "%s  {\"builder\": \"%s\", \"n\": %i, \"threads\": %i, \"seed\": %llu, \"queries\": %i, \"radius\": %g, "
+                "\"build_s\": %.6f, \"height\": %i, \"nodes\": %i, \"leaf_fill\": %.3f, \"sibling_overlap\": %.3f, "
+                "\"memory_bytes\": %zu, \"accesses_per_query\": %.3f, \"distances_per_query\": %.3f, "
+                "\"results_per_query\": %.3f, \"latency_p50_us\": %.3f, \"latency_p90_us\": %.3f, \"latency_p99_us\": %.3f, "
+                "\"latency_max_us\": %.3f, \"queries_per_s\": %.1f}",
+                first ? "" : ",\n", r->builder, r->n, options->threads, (unsigned long long)options->seed, options->queries,
+                options->radius, r->build_seconds, r->height, r->nodes, r->leaf_fill, r->sibling_overlap, r->memory_bytes, r->accesses, r->distances, r->results, r->p50, r->p90, r->p99,
+                r->max_latency, r->queries_per_second);
+    }
+    else {
+        if (first)
+            fprintf(out, "builder,n,threads,seed,queries,radius,build_s,height,nodes,leaf_fill,sibling_overlap,memory_bytes,accesses_per_query,distances_per_query,"
+                    "results_per_query,latency_p50_us,latency_p90_us,latency_p99_us,latency_max_us,queries_per_s\n");
+        fprintf(out, "%s,%i,%i,%llu,%i,%g,%.6f,%i,%i,%.3f,%.3f,%zu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f\n",
+                r->builder, r->n, options->threads, (unsigned long long)options->seed, options->queries, options->radius,
+                r->build_seconds, r->height, r->nodes, r->leaf_fill, r->sibling_overlap, r->memory_bytes, r->accesses, r->distances, r->results, r->p50, r->p90, r->p99, r->max_latency,
+                r->queries_per_second);
+    }
+    fflush(out);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = parse_bench_options(argc, argv);
+
+    FILE* out = stdout;
+    if (options.output != NULL) {
+        out = fopen(options.output, "w");
+        if (out == NULL) {
+            printf("No se pudo abrir el archivo de resultados %s.\n", options.output);
+            exit(1);
+        }
+    }
+
+    // Las consultas usan una secuencia distinta a la de los puntos, así que son las mismas para todos los conjuntos
+    Query* Qs = (Query*)malloc(options.queries * sizeof(Query));
+    uint64_t query_state = options.seed ^ 0xA5A5A5A5A5A5A5A5ULL;
+    for (int j = 0; j < options.queries; j++) {
+        generate_points(&Qs[j].q, 1, &query_state);
+        Qs[j].r = options.radius;
+    }
+
+    ThreadPool* pool = options.threads > 1 ? create_thread_pool(options.threads) : NULL;
+
+    if (options.json)
+        fprintf(out, "[\n");
+    int first = 1;
+    for (int k = options.min_exp; k <= options.max_exp; k++) {
+        int n = 1 << k;
+        // Los puntos de cada conjunto son los mismos que generate_point_file escribe con la misma semilla
+        Point* P = (Point*)malloc(n * sizeof(Point));
+        uint64_t point_state = options.seed;
+        generate_points(P, n, &point_state);
+
+        for (int builder = BENCH_CP; builder <= BENCH_HILBERT; builder <<= 1) {
+            if (!(options.builders & builder))
+                continue;
+            BenchResult result = run_bench(builder, P, n, Qs, &options, pool);
+            print_bench_result(out, &result, &options, first);
+            first = 0;
+        }
+        free(P);
+    }
+    if (options.json)
+        fprintf(out, "\n]\n");
+
+    if (pool != NULL)
+        destroy_thread_pool(pool);
+    free(Qs);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "mtree.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Función que genera n puntos aleatorios en [0, 1]^Dim
+template <typename Tree>
+std::vector<typename Tree::Point> randomPoints(int n, std::mt19937& rng) {
+    std::uniform_real_distribution<double> coordinate(0.0, 1.0);
+    std::vector<typename Tree::Point> points(n);
+    for (auto& p : points)
+        for (auto& x : p)
+            x = coordinate(rng);
+    return points;
+}
+
+// Función que construye un árbol de n puntos con CP y con SS, y mide el tiempo de construcción y los accesos de 100
+// consultas cuyo radio encierra cerca del 1% de los puntos. Los puntos de cada consulta se comparan con los de fuerza bruta
+template <typename Tree>
+void experiment(const std::string& name, int n, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::vector<typename Tree::Point> P = randomPoints<Tree>(n, rng);
+    std::vector<typename Tree::Point> Q = randomPoints<Tree>(100, rng);
+
+    // the radius of each query is its distance to the n/100-th closest point
+    std::vector<typename Tree::Point::value_type> radii;
+    std::vector<std::vector<typename Tree::Point>> expected;
+    for (const auto& q : Q) {
+        std::vector<typename Tree::Point::value_type> distances;
+        for (const auto& p : P)
+            distances.push_back(Tree::distance(q, p));
+        std::vector<typename Tree::Point::value_type> sorted = distances;
+        std::nth_element(sorted.begin(), sorted.begin() + n / 100, sorted.end());
+        radii.push_back(sorted[n / 100]);
+
+        std::vector<typename Tree::Point> inside;
+        for (std::size_t i = 0; i < P.size(); i++)
+            if (distances[i] <= radii.back())
+                inside.push_back(P[i]);
+        std::sort(inside.begin(), inside.end());
+        expected.push_back(inside);
+    }
+
+    for (int method = 0; method < 2; method++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        Tree tree = method == 0 ? Tree::ciacciaPatella(P, seed) : Tree::sextonSwinbank(P);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> build_time = end - start;
+
+        long points_found = 0;
+        int disk_accesses = 0;
+        std::vector<std::vector<typename Tree::Point>> results;
+        start = std::chrono::high_resolution_clock::now();
+        for (std::size_t i = 0; i < Q.size(); i++) {
+            results.push_back(tree.rangeSearch(Q[i], radii[i], &disk_accesses));
+            points_found += results.back().size();
+        }
+        end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> query_time = end - start;
+
+        int wrong_queries = 0;
+        for (std::size_t i = 0; i < Q.size(); i++) {
+            std::sort(results[i].begin(), results[i].end());
+            wrong_queries += results[i] != expected[i];
+        }
+
+        std::cout << name << (method == 0 ? " CP" : " SS") << " (B = " << Tree::B << ", altura " << tree.height() << "): "
+                  << "construcción " << build_time.count() << " segundos, "
+                  << disk_accesses / (double)Q.size() << " accesos y " << points_found / (double)Q.size() << " puntos por consulta, "
+                  << Q.size() / query_time.count() << " consultas por segundo, "
+                  << wrong_queries << " consultas distintas a fuerza bruta" << std::endl;
+    }
+}
+
+int main() {
+    int n = 1 << 12; // Se debe modificar si se quieren realizar experimentos con más puntos
+    experiment<MTree<2, double, L2Metric>>("2D L2", n, 1);
+    experiment<MTree<16, double, L2Metric>>("16D L2", n, 2);
+    experiment<MTree<16, double, L1Metric>>("16D L1", n, 3);
+    experiment<MTree<16, double, LInfMetric>>("16D Linf", n, 4);
+    experiment<MTree<64, float, CosineMetric>>("64D coseno (float)", n, 5);
+    experiment<MTree<128, double, L2Metric>>("128D L2", n, 6);
+    return 0;
+}
@@ -1,10 +1,65 @@
 #include "ss.c"
+#include "snapshot.c"
+#include "compact.c"
+#include "external.c"
+#include "parallel.c"
+#include "soa.c"
+#include "delete.c"
+#include "stats.c"
+#include "hilbert.c"
+#include "join.c"
+
+// Cantidad de páginas que mantiene en memoria el cache del árbol paginado
+#define PAGE_CACHE_PAGES 64
+
+// Cantidad de consultas del experimento de consultas en paralelo
+#define PARALLEL_QUERIES 100000
+
+// Cantidad de conjuntos de puntos que usan los experimentos (entre 1 y 16, el conjunto i tiene 2^(i + 10) puntos).
+// Es la cota de todos los ciclos de experimentos y solo se cargan esos conjuntos, cuyos archivos se generan si no existen
+#define EXPERIMENT_SETS 1
+
+// Distancia máxima entre los puntos de los pares que busca el experimento de join
+#define JOIN_EPS 0.01
+
+// Semilla de los archivos de puntos, fija para que todas las máquinas usen los mismos puntos
+#define POINT_FILE_SEED 2024
 
 // Function that returns a random double value between 0 and 1
 double random_double() {
     return (double)rand() / RAND_MAX;
 }
 
+// Function that counts the points of a query, used as the callback of range_search_visit
+int count_point(Point p, void *ctx) {
+    (void)p;
+    (*(long*)ctx)++;
+    return 0;
+}
+
+// Function that counts the pairs of a join, used as the callback of similarity_join
+int count_pair(Point p1, Point p2, void *ctx) {
+    (void)p1;
+    (void)p2;
+    (*(long*)ctx)++;
+    return 0;
+}
+
+// Function that queries every point of P with radius 0, with range_exists and with a cursor, and returns how many of them
+// the tree does not find. A point exactly on a covering radius must not be pruned
+int missed_stored_points(Node *tree, Point *P, int P_size) {
+    int missed = 0;
+    for (int j = 0; j < P_size; j++) {
+        Query q = {P[j], 0.0};
+        int acceses = 0;
+        Point p;
+        RangeCursor *cursor = open_range_cursor(tree, q);
+        missed += !range_exists(tree, q, &acceses) || !range_cursor_next(cursor, &p);
+        close_range_cursor(cursor);
+    }
+    return missed;
+}
+
 // Function that returns two to the exponent
 int power_of_two(int exponent) {
     int result = 1;
@@ -19,8 +74,10 @@ int main() {
     // ======================
     // Determinar tamano de B
     // ======================
-    printf("Entry size: %i\n", sizeof(Entry));
-    printf("B: %d\n\n", 4096 / sizeof(Entry));
+    // B no se calcula desde el tamaño de Entry: se mantiene en node_capacity, por lo que los nodos en memoria ya no ocupan 4 KiB
+    printf("Entry size: %zu\n", sizeof(Entry));
+    printf("B: %d, b: %d (%zu bytes por nodo en memoria)\n", B, b, B * sizeof(Entry));
+    printf("Distance kernels: %s\n\n", distance_kernels.name);
 
     // =====================================================================================================
     // Creación set de puntos aleatorios para cada n entre 2**10 y 2**25 y set de consultas Q con 100 puntos
@@ -42,6 +99,15 @@ int main() {
         Q[i].r = 0.02;
     }
 
+    // Arreglo de consultas para medir el rendimiento de las consultas en paralelo
+    Query *parallel_Q = (Query*)malloc(PARALLEL_QUERIES * sizeof(Query));
+    for (int i = 0; i < PARALLEL_QUERIES; i++) {
+        parallel_Q[i].q.x = random_double();
+        parallel_Q[i].q.y = random_double();
+        parallel_Q[i].r = 0.02;
+    }
+    QueryResult *parallel_results = (QueryResult*)malloc(PARALLEL_QUERIES * sizeof(QueryResult));
+
     // Imprimimos 5 puntos para probar que funcionó
     for (int i = 0; i < 5; i++) {
         printf("Query %d - Point: (%lf, %lf)\n", i + 1, Q[i].q.x, Q[i].q.y);
@@ -56,16 +122,31 @@ int main() {
     // Imprimimos primera cantidad para probar que funcionó
     printf("Array %i size: %i\n", 1, point_nums[0]);
 
-    // Arreglo con punteros a cada arreglo de puntos
+    // Arreglo con punteros a cada arreglo de puntos. Los puntos de cada conjunto se leen con mmap de un archivo que se
+    // genera una sola vez con una semilla fija, así que solo ocupan memoria los conjuntos que se usan
     Point *P[16];
+    PointSource *point_sources[16];
+    char point_paths[16][32];
 
-    // Creamos puntos aleatorios para cada arreglo
     for (int i = 0; i < 16; i++) {
-        P[i] = (Point*)malloc(point_nums[i] * sizeof(Point));
-        for (int j = 0; j < point_nums[i]; j++) {
-            P[i][j].x = random_double();
-            P[i][j].y = random_double();
+        P[i] = NULL;
+        point_sources[i] = NULL;
+        sprintf(point_paths[i], "points-%i.bin", point_nums[i]);
+    }
+    for (int i = 0; i < EXPERIMENT_SETS; i++) {
+        point_sources[i] = open_point_source(point_paths[i], 1);
+        if (point_sources[i] == NULL || point_sources[i]->size != point_nums[i]) {
+            if (point_sources[i] != NULL) {
+                close_point_source(point_sources[i]);
+            }
+            if (generate_point_file(point_paths[i], point_nums[i], POINT_FILE_SEED + i) != 0) {
+                printf("No se pudo escribir el archivo de puntos %s.\n", point_paths[i]);
+                exit(1);
+            }
+            point_sources[i] = open_point_source(point_paths[i], 1);
         }
+        // the loaders only read the points, so they can use the read only mapping
+        P[i] = (Point*)point_sources[i]->points;
     }
 
     // Imprimimos 5 puntos del primer arreglo para probar que funcionó
@@ -84,44 +165,468 @@ int main() {
     // Iteramos en cada conjunto con las 100 consultas y almacenamos accesos
     printf("Begin experiment\n");
     printf("Begin ss algorithm experiments\n");
-    for (int i = 0; i < 1; i++) { // Este ciclo for se debe modificar si se quieren realizar experimentos con más puntos
+    for (int i = 0; i < EXPERIMENT_SETS; i++) { // Para realizar experimentos con más puntos se debe aumentar EXPERIMENT_SETS
+        // Los pares de MinMaxSplitPolicy se evalúan en paralelo con todos los núcleos
+        split_pool = create_thread_pool(available_cores());
+        // Los nodos del árbol se guardan en un arena, y se liberan todos juntos al terminar con el árbol
+        node_arena = create_arena(ARENA_BLOCK_SIZE, 1);
         Node *ss_tree = sextonSwinbank(P[i], point_nums[i]);
+        destroy_thread_pool(split_pool);
+        split_pool = NULL;
+
+        // El mismo árbol leyendo el archivo de puntos por bloques con pread, sin tener todos los puntos en memoria
+        PointSource *ss_stream = open_point_source(point_paths[i], 0);
+        double stream_start = wall_seconds();
+        Node *ss_stream_tree = sextonSwinbankFromSource(ss_stream);
+        printf("SS build from streamed point file for set %i: %.3f s, same tree: %s\n", i + 1, wall_seconds() - stream_start, equalTrees(ss_tree, ss_stream_tree) ? "yes" : "no");
+        close_point_source(ss_stream);
+
         int acceses = 0;
         for (int j = 0; j < 100; j++) {
-            Point *search = search_points_in_radio(ss_tree, Q[j], &acceses);
+            int search_size;
+            Point *search = search_points_in_radio(ss_tree, Q[j], &search_size, &acceses);
+            free(search);
         }
         ss_disk_acceses[i] = acceses;
+
+        // Forma del árbol, para comparar sus accesos con los del árbol de CP
+        printf("SS tree stats for set %i:\n", i + 1);
+        TreeStats *ss_stats = mtree_stats(ss_tree);
+        print_tree_stats(ss_stats);
+        free_tree_stats(ss_stats);
+        printf("SS stored points missed by radius 0 queries for set %i: %i\n", i + 1, missed_stored_points(ss_tree, P[i], point_nums[i]));
+
+        // Guardamos el árbol como snapshot, para que otra ejecución lo cargue con mmap en vez de construirlo
+        if (write_snapshot(ss_tree, "ss-tree.snap") != 0) {
+            printf("No se pudo escribir el snapshot.\n");
+            exit(1);
+        }
+        Snapshot *ss_snapshot = open_snapshot("ss-tree.snap");
+        int snapshot_acceses = 0;
+        for (int j = 0; j < 100; j++) {
+            int search_size;
+            Point *search = snapshot_search_points_in_radio(ss_snapshot, Q[j], &search_size, &snapshot_acceses);
+            free(search);
+        }
+        printf("SS snapshot acceses for set %i: %i\n", i + 1, snapshot_acceses);
+        close_snapshot(ss_snapshot);
+        destroy_arena(node_arena);
+        node_arena = NULL;
     }
     printf("Passed ss algorithm\n\n");
     
     // 2. Ciaccia Patella
     // Arreglo con accesos a disco de cada número de puntos
     int cp_disk_acceses[16];
+    // Arreglo con lecturas reales de páginas al consultar el árbol guardado en disco
+    int cp_paged_acceses[16];
 
     // Iteramos en cada conjunto con las 100 consultas y almacenamos accesos
     
     printf("Begin cp algorithm experiments\n");
-    for (int i = 0; i < 1; i++) { // Este ciclo for se debe modificar si se quieren realizar experimentos con más puntos
-        Node *cp_tree = ciacciaPatella(P[i], point_nums[i]);
+    for (int i = 0; i < EXPERIMENT_SETS; i++) { // Para realizar experimentos con más puntos se debe aumentar EXPERIMENT_SETS
+        unsigned int cp_seed = rand();
+        // Los dos árboles comparten el arena de nodos, que se libera con una sola llamada. Es compartido porque la construcción paralela crea nodos desde varios hilos
+        node_arena = create_arena(ARENA_BLOCK_SIZE, 1);
+        double build_start = wall_seconds();
+        Node *cp_tree = ciacciaPatellaSeeded(P[i], point_nums[i], cp_seed);
+        double build_time = wall_seconds() - build_start;
+
+        // Construcción paralela con la misma semilla, debe producir el mismo árbol
+        ThreadPool *build_pool = create_thread_pool(available_cores());
+        build_start = wall_seconds();
+        Node *cp_parallel_tree = ciacciaPatellaParallel(P[i], point_nums[i], cp_seed, build_pool);
+        double parallel_build_time = wall_seconds() - build_start;
+        destroy_thread_pool(build_pool);
+        printf("CP build for set %i: %.3f s sequential, %.3f s with %i threads, same tree: %s\n", i + 1, build_time, parallel_build_time, available_cores(), equalTrees(cp_tree, cp_parallel_tree) ? "yes" : "no");
+
+        // El mismo árbol leyendo el archivo de puntos por bloques con pread, sin tener todos los puntos en memoria
+        PointSource *cp_stream = open_point_source(point_paths[i], 0);
+        build_start = wall_seconds();
+        Node *cp_stream_tree = ciacciaPatellaFromSource(cp_stream, cp_seed);
+        printf("CP build from streamed point file for set %i: %.3f s, same tree: %s\n", i + 1, wall_seconds() - build_start, equalTrees(cp_tree, cp_stream_tree) ? "yes" : "no");
+        close_point_source(cp_stream);
+
         int acceses = 0;
+        distance_computations = 0;
+        distance_computations_saved = 0;
         for (int j = 0; j < 100; j++) {
-            Point *search = search_points_in_radio(cp_tree, Q[j], &acceses);
+            int search_size;
+            Point *search = search_points_in_radio(cp_tree, Q[j], &search_size, &acceses);
+            free(search);
         }
         cp_disk_acceses[i] = acceses;
+        // Distancias evitadas con la distancia de cada entrada a su entrada padre
+        printf("CP distance computations per query for set %i: %.1f computed, %.1f saved\n", i + 1, distance_computations / 100.0, distance_computations_saved / 100.0);
+        printf("CP tree stats for set %i:\n", i + 1);
+        TreeStats *cp_stats = mtree_stats(cp_tree);
+        print_tree_stats(cp_stats);
+        free_tree_stats(cp_stats);
+        // Las mismas consultas entregando cada punto a una función o pidiéndolos a un cursor, sin juntarlos en un arreglo
+        long visited_points = 0;
+        long cursor_points = 0;
+        int visit_acceses = 0;
+        int cursor_acceses = 0;
+        for (int j = 0; j < 100; j++) {
+            visit_acceses += range_search_visit(cp_tree, Q[j], count_point, &visited_points);
+            RangeCursor *cursor = open_range_cursor(cp_tree, Q[j]);
+            Point p;
+            while (range_cursor_next(cursor, &p)) {
+                cursor_points++;
+            }
+            cursor_acceses += cursor->disk_accesses;
+            close_range_cursor(cursor);
+        }
+        printf("CP streamed points for set %i: %ld with callback, %ld with cursor (%i and %i acceses)\n", i + 1, visited_points, cursor_points, visit_acceses, cursor_acceses);
+
+        // Las mismas consultas contando sus puntos o solo verificando si tienen alguno, sin visitar los subárboles que no hace falta
+        long counted_points = 0;
+        int non_empty = 0;
+        int count_acceses = 0;
+        int exists_acceses = 0;
+        for (int j = 0; j < 100; j++) {
+            counted_points += range_count(cp_tree, Q[j], &count_acceses);
+            non_empty += range_exists(cp_tree, Q[j], &exists_acceses);
+        }
+        printf("CP range count for set %i: %ld points, %i acceses; range exists: %i non empty queries, %i acceses\n", i + 1, counted_points, count_acceses, non_empty, exists_acceses);
+
+        printf("CP stored points missed by radius 0 queries for set %i: %i\n", i + 1, missed_stored_points(cp_tree, P[i], point_nums[i]));
+
+        // Consultas por segundo repartiendo las consultas entre 1 hasta todos los núcleos: cada potencia de dos que no supera
+        // la cantidad de núcleos, y al final todos los núcleos si no son una potencia de dos
+        int cores = available_cores();
+        for (int threads = 1; threads <= cores; threads = (threads < cores && threads * 2 > cores) ? cores : threads * 2) {
+            ThreadPool *pool = create_thread_pool(threads);
+            int parallel_acceses = 0;
+            double start = wall_seconds();
+            parallel_search_points_in_radio(pool, cp_tree, parallel_Q, PARALLEL_QUERIES, parallel_results, &parallel_acceses);
+            double elapsed = wall_seconds() - start;
+            printf("CP parallel queries for set %i with %i threads: %.0f queries/s, %i acceses\n", i + 1, threads, PARALLEL_QUERIES / elapsed, parallel_acceses);
+            for (int j = 0; j < PARALLEL_QUERIES; j++) {
+                free(parallel_results[j].points);
+            }
+            destroy_thread_pool(pool);
+        }
+
+        // Las mismas 100 consultas en un solo recorrido del árbol, compartiendo las visitas a cada nodo
+        int batch_acceses = 0;
+        int batch_sizes[100];
+        Point **batch_search = search_points_in_radio_batch(cp_tree, Q, 100, batch_sizes, &batch_acceses);
+        for (int j = 0; j < 100; j++) {
+            free(batch_search[j]);
+        }
+        free(batch_search);
+        printf("CP batch acceses for set %i: %i\n", i + 1, batch_acceses);
+
+        // Consultas de los 10 vecinos más cercanos a cada punto de consulta
+        int knn_acceses = 0;
+        distance_computations = 0;
+        distance_computations_saved = 0;
+        for (int j = 0; j < 100; j++) {
+            int knn_size;
+            Point *neighbors = knn_search(cp_tree, Q[j].q, 10, &knn_size, &knn_acceses);
+            free(neighbors);
+        }
+        printf("CP 10-NN acceses for set %i: %i\n", i + 1, knn_acceses);
+        printf("CP 10-NN distance computations per query for set %i: %.1f computed, %.1f saved\n", i + 1, distance_computations / 100.0, distance_computations_saved / 100.0);
+
+        // Consultas por segundo en un hilo descartando o no las entradas con su distancia al padre
+        int default_pruning = parent_distance_pruning;
+        for (int pruning = 1; pruning >= 0; pruning--) {
+            parent_distance_pruning = pruning;
+            int pruning_acceses = 0;
+            distance_computations = 0;
+            distance_computations_saved = 0;
+            double pruning_start = wall_seconds();
+            for (int j = 0; j < PARALLEL_QUERIES; j++) {
+                int search_size;
+                Point *search = search_points_in_radio(cp_tree, parallel_Q[j], &search_size, &pruning_acceses);
+                free(search);
+            }
+            double pruning_time = wall_seconds() - pruning_start;
+            printf("CP queries for set %i %s parent distance pruning: %.0f queries/s, %.1f distances computed and %.1f saved per query\n", i + 1, pruning ? "with" : "without",
+                   PARALLEL_QUERIES / pruning_time, (double)distance_computations / PARALLEL_QUERIES, (double)distance_computations_saved / PARALLEL_QUERIES);
+        }
+        parent_distance_pruning = default_pruning;
+
+        // Consultas por segundo en un hilo con los nodos originales y con la copia con los campos separados (SoA)
+        SoaTree *soa_tree = create_soa_tree(cp_tree);
+        int aos_acceses = 0;
+        int soa_acceses = 0;
+        double aos_start = wall_seconds();
+        for (int j = 0; j < PARALLEL_QUERIES; j++) {
+            int search_size;
+            Point *search = search_points_in_radio(cp_tree, parallel_Q[j], &search_size, &aos_acceses);
+            free(search);
+        }
+        double soa_start = wall_seconds();
+        for (int j = 0; j < PARALLEL_QUERIES; j++) {
+            int search_size;
+            Point *search = soa_search_points_in_radio(soa_tree, parallel_Q[j], &search_size, &soa_acceses);
+            free(search);
+        }
+        double soa_end = wall_seconds();
+        printf("CP queries for set %i: %.0f queries/s with Entry nodes, %.0f queries/s with SoA nodes (%i and %i acceses)\n", i + 1, PARALLEL_QUERIES / (soa_start - aos_start), PARALLEL_QUERIES / (soa_end - soa_start), aos_acceses, soa_acceses);
+        int soa_missed = 0;
+        int soa_exact_acceses = 0;
+        for (int j = 0; j < point_nums[i]; j++) {
+            Query q = {P[i][j], 0.0};
+            int search_size;
+            Point *search = soa_search_points_in_radio(soa_tree, q, &search_size, &soa_exact_acceses);
+            soa_missed += search_size == 0;
+            free(search);
+        }
+        printf("CP stored points missed by radius 0 queries on SoA nodes for set %i: %i\n", i + 1, soa_missed);
+        destroy_soa_tree(soa_tree);
+
+        // Consultas por segundo con cada versión de las funciones de distancia que soporta la CPU
+        for (int k = 0; k < NUM_DISTANCE_KERNELS; k++) {
+            if (set_distance_kernels(distance_kernels_list[k].name) != 0) {
+                continue;
+            }
+            int kernel_acceses = 0;
+            double kernel_start = wall_seconds();
+            for (int j = 0; j < PARALLEL_QUERIES; j++) {
+                int search_size;
+                Point *search = search_points_in_radio(cp_tree, parallel_Q[j], &search_size, &kernel_acceses);
+                free(search);
+            }
+            printf("CP queries for set %i with %s distances: %.0f queries/s\n", i + 1, distance_kernels.name, PARALLEL_QUERIES / (wall_seconds() - kernel_start));
+        }
+        select_distance_kernels();
+
+        // Repetimos las consultas sobre el árbol guardado en páginas de 4 KiB, leídas con pread a través del cache
+        if (write_paged_tree(cp_tree, "cp-tree.pages") != 0) {
+            printf("No se pudo escribir el árbol paginado.\n");
+            exit(1);
+        }
+        PagedTree *paged_tree = open_paged_tree("cp-tree.pages", PAGE_CACHE_PAGES);
+        int paged_acceses = 0;
+        for (int j = 0; j < 100; j++) {
+            int search_size;
+            Point *search = paged_search_points_in_radio(paged_tree, Q[j], &search_size, &paged_acceses);
+            free(search);
+        }
+        cp_paged_acceses[i] = paged_acceses;
+        printf("Page cache for set %i: %ld hits, %ld misses, %ld evictions\n", i + 1, paged_tree->cache.hits, paged_tree->cache.misses, paged_tree->cache.evictions);
+        close_paged_tree(paged_tree);
+
+        // El mismo árbol construido fuera de memoria desde el archivo de puntos, con memoria para un cuarto de los puntos
+        PointSource *external_source = open_point_source(point_paths[i], 0);
+        ExternalBuild external_stats;
+        double external_start = wall_seconds();
+        if (ciacciaPatellaExternal(external_source, cp_seed, point_nums[i] * sizeof(Point) / 4, ".", "cp-tree-external.pages", &external_stats) != 0) {
+            printf("No se pudo construir el árbol fuera de memoria.\n");
+            exit(1);
+        }
+        double external_time = wall_seconds() - external_start;
+        close_point_source(external_source);
+        PagedTree *external_tree = open_paged_tree("cp-tree-external.pages", PAGE_CACHE_PAGES);
+        int external_acceses = 0;
+        for (int j = 0; j < 100; j++) {
+            int search_size;
+            Point *search = paged_search_points_in_radio(external_tree, Q[j], &search_size, &external_acceses);
+            free(search);
+        }
+        printf("CP external build for set %i: %.3f s, %ld spilled points in %i partitions, %i subtrees built in memory, %i unused pages, %i page reads\n", i + 1, external_time, external_stats.spilled_points, external_stats.partitions, external_stats.memory_builds, external_stats.unused_pages, external_acceses);
+        close_paged_tree(external_tree);
+
+        // Construimos el árbol con nodos tan grandes como caben en cada formato de página compacto y lo guardamos en ese formato.
+        // Los puntos que entregan son los guardados, redondeados, por lo que la cantidad de puntos puede diferir en el borde de las consultas
+        const char *encoding_names[] = {"float32", "int16"};
+        for (int encoding = COMPACT_FLOAT32; encoding <= COMPACT_INT16; encoding++) {
+            node_capacity = compact_node_capacity(encoding);
+            Node *compact_tree = ciacciaPatellaSeeded(P[i], point_nums[i], cp_seed);
+            node_capacity = 128;
+            if (write_compact_tree(compact_tree, "cp-tree.compact", encoding) != 0) {
+                printf("No se pudo escribir el árbol compacto.\n");
+                exit(1);
+            }
+            PagedTree *compact_paged_tree = open_compact_tree("cp-tree.compact", PAGE_CACHE_PAGES);
+            int compact_acceses = 0;
+            long compact_points = 0;
+            for (int j = 0; j < 100; j++) {
+                int search_size;
+                Point *search = compact_search_points_in_radio(compact_paged_tree, Q[j], &search_size, &compact_acceses);
+                compact_points += search_size;
+                free(search);
+            }
+            printf("CP %s compact pages for set %i: B = %i, height %i, %u pages, %i page reads, %ld points\n", encoding_names[encoding], i + 1, compact_node_capacity(encoding), treeHeight(compact_tree), compact_paged_tree->header.page_count, compact_acceses, compact_points);
+            close_paged_tree(compact_paged_tree);
+        }
+        printf("CP node arena for set %i: %zu bytes\n", i + 1, node_arena->allocated);
+        destroy_arena(node_arena);
+        node_arena = NULL;
     }
     printf("Passed cp algorithm\n\n");
+
+    // 3. Curva de Hilbert
+    // Arreglo con accesos a disco de cada número de puntos
+    int hilbert_disk_acceses[16];
+
+    printf("Begin hilbert bulk loading experiments\n");
+    for (int i = 0; i < EXPERIMENT_SETS; i++) { // Para realizar experimentos con más puntos se debe aumentar EXPERIMENT_SETS
+        node_arena = create_arena(ARENA_BLOCK_SIZE, 1);
+        double hilbert_start = wall_seconds();
+        Node *hilbert_tree = hilbertBulkLoad(P[i], point_nums[i]);
+        double hilbert_time = wall_seconds() - hilbert_start;
+
+        // El orden de la curva no depende de los hilos, así que el árbol construido en paralelo debe ser el mismo
+        ThreadPool *hilbert_pool = create_thread_pool(available_cores());
+        hilbert_start = wall_seconds();
+        Node *hilbert_parallel_tree = hilbertBulkLoadParallel(P[i], point_nums[i], hilbert_pool);
+        double hilbert_parallel_time = wall_seconds() - hilbert_start;
+        destroy_thread_pool(hilbert_pool);
+        printf("Hilbert build for set %i: %.3f s sequential, %.3f s with %i threads, same tree: %s\n", i + 1, hilbert_time, hilbert_parallel_time, available_cores(), equalTrees(hilbert_tree, hilbert_parallel_tree) ? "yes" : "no");
+
+        int acceses = 0;
+        for (int j = 0; j < 100; j++) {
+            int search_size;
+            Point *search = search_points_in_radio(hilbert_tree, Q[j], &search_size, &acceses);
+            free(search);
+        }
+        hilbert_disk_acceses[i] = acceses;
+        printf("Hilbert tree stats for set %i:\n", i + 1);
+        TreeStats *hilbert_stats = mtree_stats(hilbert_tree);
+        print_tree_stats(hilbert_stats);
+        free_tree_stats(hilbert_stats);
+        printf("Hilbert stored points missed by radius 0 queries for set %i: %i\n", i + 1, missed_stored_points(hilbert_tree, P[i], point_nums[i]));
+        destroy_arena(node_arena);
+        node_arena = NULL;
+    }
+    printf("Passed hilbert bulk loading\n\n");
+
+    // 4. Inserción dinámica
+    // Construimos el árbol insertando un punto a la vez con cada combinación de políticas de división
+    const char *promote_names[] = {"random", "mM_RAD", "M_LB_DIST"};
+    const char *partition_names[] = {"hyperplane", "balanced"};
+    printf("Begin insertion experiments\n");
+    for (int i = 0; i < EXPERIMENT_SETS; i++) { // Para realizar experimentos con más puntos se debe aumentar EXPERIMENT_SETS
+        for (int promote = PROMOTE_RANDOM; promote <= PROMOTE_M_LB_DIST; promote++) {
+            for (int partition = PARTITION_HYPERPLANE; partition <= PARTITION_BALANCED; partition++) {
+                insert_policy.promote = promote;
+                insert_policy.partition = partition;
+                node_arena = create_arena(ARENA_BLOCK_SIZE, 0);
+                double insert_start = wall_seconds();
+                Node *insert_tree = create_node();
+                for (int j = 0; j < point_nums[i]; j++) {
+                    mtree_insert(insert_tree, P[i][j]);
+                }
+                double insert_time = wall_seconds() - insert_start;
+                int acceses = 0;
+                for (int j = 0; j < 100; j++) {
+                    int search_size;
+                    Point *search = search_points_in_radio(insert_tree, Q[j], &search_size, &acceses);
+                    free(search);
+                }
+                printf("Insertion for set %i with %s promotion and %s partition: %.3f s, %i acceses\n", i + 1, promote_names[promote], partition_names[partition], insert_time, acceses);
+                destroy_arena(node_arena);
+                node_arena = NULL;
+            }
+        }
+    }
+    printf("Passed insertion\n\n");
+
+    // 5. Borrado
+    // Borramos la mitad de los puntos de los árboles de CP y SS, con y sin ajustar los radios cobertores del camino
+    printf("Begin deletion experiments\n");
+    for (int i = 0; i < EXPERIMENT_SETS; i++) { // Para realizar experimentos con más puntos se debe aumentar EXPERIMENT_SETS
+        for (int tighten = 0; tighten <= 1; tighten++) {
+            delete_tighten_radii = tighten;
+            for (int loader = 0; loader < 2; loader++) {
+                node_arena = create_arena(ARENA_BLOCK_SIZE, 1);
+                Node *delete_tree = loader == 0 ? ciacciaPatella(P[i], point_nums[i]) : sextonSwinbank(P[i], point_nums[i]);
+                double delete_start = wall_seconds();
+                for (int j = 0; j < point_nums[i] / 2; j++) {
+                    mtree_delete(delete_tree, P[i][j]);
+                }
+                double delete_time = wall_seconds() - delete_start;
+                int acceses = 0;
+                for (int j = 0; j < 100; j++) {
+                    int search_size;
+                    Point *search = search_points_in_radio(delete_tree, Q[j], &search_size, &acceses);
+                    free(search);
+                }
+                printf("Deletion of half of set %i from %s tree %s tightening radii: %.3f s, %i acceses\n", i + 1, loader == 0 ? "CP" : "SS", tighten ? "with" : "without", delete_time, acceses);
+                destroy_arena(node_arena);
+                node_arena = NULL;
+            }
+        }
+    }
+    printf("Passed deletion\n\n");
+
+    // 6. Join por similitud
+    // Pares de puntos a distancia a lo más JOIN_EPS, con un join del árbol consigo mismo y con una consulta por punto
+    printf("Begin similarity join experiments\n");
+    for (int i = 0; i < EXPERIMENT_SETS; i++) { // Para realizar experimentos con más puntos se debe aumentar EXPERIMENT_SETS
+        node_arena = create_arena(ARENA_BLOCK_SIZE, 1);
+        Node *join_tree = ciacciaPatella(P[i], point_nums[i]);
+
+        long join_pairs = 0;
+        int join_acceses = 0;
+        double join_start = wall_seconds();
+        self_similarity_join(join_tree, JOIN_EPS, count_pair, &join_pairs, &join_acceses);
+        double join_time = wall_seconds() - join_start;
+
+        // Each pair is found by the queries of both of its points, and every point finds itself
+        long query_pairs = 0;
+        int query_acceses = 0;
+        double query_start = wall_seconds();
+        for (int j = 0; j < point_nums[i]; j++) {
+            Query q = {P[i][j], JOIN_EPS};
+            query_pairs += range_count(join_tree, q, &query_acceses);
+        }
+        query_pairs = (query_pairs - point_nums[i]) / 2;
+        double query_time = wall_seconds() - query_start;
+        printf("Self join of set %i with eps %g: %ld pairs, %.3f s, %i acceses; one query per point: %ld pairs, %.3f s, %i acceses\n", i + 1, JOIN_EPS, join_pairs, join_time, join_acceses, query_pairs, query_time, query_acceses);
+
+        // Cada hilo cuenta sus pares en su propio contador
+        ThreadPool *join_pool = create_thread_pool(available_cores());
+        long *worker_pairs = (long*)calloc(join_pool->num_threads, sizeof(long));
+        void **worker_ctx = (void**)malloc(join_pool->num_threads * sizeof(void*));
+        for (int w = 0; w < join_pool->num_threads; w++) {
+            worker_ctx[w] = &worker_pairs[w];
+        }
+        int parallel_join_acceses = 0;
+        join_start = wall_seconds();
+        long parallel_pairs = parallel_similarity_join(join_pool, join_tree, NULL, JOIN_EPS, count_pair, worker_ctx, &parallel_join_acceses);
+        printf("Parallel self join of set %i with %i threads: %ld pairs, %.3f s, %i acceses\n", i + 1, join_pool->num_threads, parallel_pairs, wall_seconds() - join_start, parallel_join_acceses);
+
+        // Join con un árbol de Hilbert de otro conjunto del mismo tamaño
+        Point *other = (Point*)malloc(point_nums[i] * sizeof(Point));
+        uint64_t other_state = POINT_FILE_SEED + EXPERIMENT_SETS + i;
+        generate_points(other, point_nums[i], &other_state);
+        Node *other_tree = hilbertBulkLoad(other, point_nums[i]);
+        long two_tree_pairs = 0;
+        int two_tree_acceses = 0;
+        join_start = wall_seconds();
+        similarity_join(join_tree, other_tree, JOIN_EPS, count_pair, &two_tree_pairs, &two_tree_acceses);
+        printf("Join of set %i with another set of the same size: %ld pairs, %.3f s, %i acceses\n", i + 1, two_tree_pairs, wall_seconds() - join_start, two_tree_acceses);
+
+        free(other);
+        free(worker_ctx);
+        free(worker_pairs);
+        destroy_thread_pool(join_pool);
+        destroy_arena(node_arena);
+        node_arena = NULL;
+    }
+    printf("Passed similarity join\n\n");
     
     printf("End experiment\n\n");
 
     // Imprimimos accesos de cada conjunto de puntos
-    for (int i = 0; i < 1; i++) {
+    for (int i = 0; i < EXPERIMENT_SETS; i++) {
         printf("CP acceses for set %i: %i\n", i + 1, cp_disk_acceses[i]);
+        printf("CP page reads for set %i: %i\n", i + 1, cp_paged_acceses[i]);
         printf("SS acceses for set %i: %i\n", i + 1, ss_disk_acceses[i]);
+        printf("Hilbert acceses for set %i: %i\n", i + 1, hilbert_disk_acceses[i]);
     }
 
     // Liberamos memoria de cada arreglo
-    for (int i = 0; i < 16; i++) {
-        free(P[i]);
+    free(parallel_Q);
+    free(parallel_results);
+    for (int i = 0; i < EXPERIMENT_SETS; i++) {
+        close_point_source(point_sources[i]);
     }
     
     return 0;
@@ -1,3 +1,6 @@
+#ifndef MTREE_C
+#define MTREE_C
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,8 +9,16 @@
 #include <limits.h>
 #include <float.h>
 
-#define B 128
-#define b 64
+// distance.c includes the intrinsics, which must come before the B and b macros since they would clash with their parameter names
+#include "distance.c"
+#include "arena.c"
+
+// Cantidad máxima de entradas de los nodos que crean los algoritmos, y mínima (b) de los que crean CP y SS. Es una variable
+// para poder construir árboles con nodos del tamaño de un formato de página más compacto (ver compact.c)
+int node_capacity = 128;
+
+#define B node_capacity
+#define b (node_capacity / 2)
 
 typedef struct node Node;
 typedef struct entry Entry;
@@ -24,6 +35,8 @@ struct entry {
     Point p;
     double cr;
     Node *a;
+    double pd; // distance to the point of the entry that points to this node, unused in the root
+    int count; // points in the subtree a, 1 if the entry is a point
 };
 
 
@@ -31,6 +44,7 @@ struct entry {
 struct node {
     Entry *entries;
     int num_entries;
+    int capacity; // entries that fit in the entries array
 };
 
 // Estructura que representa una consulta
@@ -39,11 +53,79 @@ struct query {
     double r;
 };
 
+typedef struct pointbuffer PointBuffer;
+typedef struct cursorframe CursorFrame;
+typedef struct rangecursor RangeCursor;
+typedef struct neighbor Neighbor;
+typedef struct nodequeue NodeQueue;
+
+// Estructura que representa un arreglo de puntos que crece duplicando su capacidad
+struct pointbuffer {
+    Point* points;
+    int size;
+    int capacity;
+};
+
+// Función que recibe cada punto que cumple una consulta junto al contexto ctx del que consulta. Si retorna distinto de 0 la consulta se detiene
+typedef int (*PointVisitor)(Point p, void* ctx);
+
+// Estructura que representa un nodo pendiente de un cursor: la próxima entrada que revisa y la distancia de la consulta a su entrada padre
+struct cursorframe {
+    Node* node;
+    int next;
+    double parent_distance;
+};
+
+// Estructura que representa un cursor de consulta, que entrega los puntos de la consulta uno a uno con range_cursor_next.
+// Guarda el camino desde la raíz al nodo actual en vez de los resultados
+struct rangecursor {
+    Query Q;
+    CursorFrame* stack;
+    int depth;
+    int capacity;
+    int disk_accesses;
+};
+
+// Estructura que representa un vecino encontrado por knn_search y su distancia a la consulta
+struct neighbor {
+    Point p;
+    double dist;
+};
+
+// Estructura que representa una cola de prioridad (min-heap) de nodos, ordenada por la cota inferior de distancia
+struct nodequeue {
+    Node** nodes;
+    double* keys;
+    double* parent_distances; // distance from the query to the point of the entry that points to each node
+    int size;
+    int capacity;
+};
+
+// Cantidad de doubles entre dos puntos seguidos de un arreglo de Point y de un arreglo de Entry, para las funciones de distance.c
+#define POINT_STRIDE ((int)(sizeof(Point) / sizeof(double)))
+#define ENTRY_STRIDE ((int)(sizeof(Entry) / sizeof(double)))
+
+// Función que calcula el cuadrado de la distancia euclidiana entre p1 y p2, para comparar distancias sin sqrt
+double squared_distance(Point p1, Point p2) {
+    double dx = p2.x - p1.x;
+    double dy = p2.y - p1.y;
+    return dx * dx + dy * dy;
+}
+
 // Función que calcula la distancia euclidiana entre p1 y p2
 double euclidean_distance(Point p1, Point p2) {
-    return sqrt(pow(p2.x - p1.x, 2) + pow(p2.y - p1.y, 2));
+    return sqrt(squared_distance(p1, p2));
 }
 
+// Distancias a la consulta que calcularon range_search y knn_search en este hilo, y las que evitaron con la desigualdad triangular
+_Thread_local long distance_computations = 0;
+_Thread_local long distance_computations_saved = 0;
+
+// Si es 1, range_search y knn_search descartan entradas con su distancia al padre antes de calcular su distancia a la consulta.
+// Con la distancia euclidiana en 2 dimensiones la cota cuesta casi lo mismo que la distancia y las consultas son más lentas
+// con ella (el experimento de CP mide ambas formas), así que está desactivado por defecto
+int parent_distance_pruning = 0;
+
 // Función que encuentra el mínimo entre dos ints
 int intMin(int i, int j) {
     return i < j ? i : j;
@@ -51,7 +133,7 @@ int intMin(int i, int j) {
 
 // Función que determina si un nodo es hoja o no
 int is_leaf(Node* node) {
-    int num_entries = sizeof(node) / sizeof(Entry);
+    int num_entries = node->num_entries;
     Entry* entries = node->entries;
     for (int i=0; i < num_entries; i++) {
         if (entries[i].cr != 0.0 || entries[i].a != NULL)
@@ -60,49 +142,473 @@ int is_leaf(Node* node) {
     return 1;
 }
 
-// Función que crea un nodo
-Node* create_node() {
-    Node* node = (Node*)malloc(sizeof(Node));
+// Arena de donde se toman los nodos y sus entradas mientras no sea NULL, para que queden contiguos en memoria
+// y el árbol completo se libere con destroy_arena. Si es NULL cada nodo se reserva con malloc
+Arena* node_arena = NULL;
+
+// Función que crea un nodo con espacio para capacity entradas
+Node* create_node_with_capacity(int capacity) {
+    Node* node;
+    if (node_arena != NULL) {
+        // the entries are stored right after the node
+        node = (Node*)arena_alloc(node_arena, sizeof(Node) + capacity * sizeof(Entry));
+        node->entries = (Entry*)(node + 1);
+    }
+    else {
+        node = (Node*)malloc(sizeof(Node));
+        node->entries = (Entry*)malloc(capacity * sizeof(Entry));
+    }
     node->num_entries = 0;
+    node->capacity = capacity;
     return node;
 }
 
-// Función que realiza la query Q en el árbol node, guardando los puntos en sol_array y calculando los accesos a disco en la dirección disk_accesses
-void range_search(Node* node, Query Q, Point** sol_array, int* array_size, int* disk_accesses) {
+// Función que crea un nodo
+Node* create_node() {
+    return create_node_with_capacity(B);
+}
+
+// Función que guarda en cada entrada de node su distancia a routing, el punto de la entrada que apunta a node
+void set_parent_distances(Node* node, Point routing) {
+    int num_entries = node->num_entries;
+    double distances[num_entries + 1];
+
+    squared_distances(&routing.x, &node->entries[0].p.x, ENTRY_STRIDE, num_entries, distances);
+    for (int i = 0; i < num_entries; i++)
+        node->entries[i].pd = sqrt(distances[i]);
+}
+
+// Función que retorna la cantidad de puntos del subárbol node, sumando los contadores de sus entradas
+int subtree_count(Node* node) {
+    int count = 0;
+    for (int i = 0; i < node->num_entries; i++)
+        count += node->entries[i].count;
+    return count;
+}
+
+// Función que agrega el punto p al final del buffer, duplicando su capacidad si está lleno
+void push_point(PointBuffer* buffer, Point p) {
+    if (buffer->size == buffer->capacity) {
+        buffer->capacity = buffer->capacity == 0 ? 16 : 2 * buffer->capacity;
+        buffer->points = (Point*)realloc(buffer->points, buffer->capacity * sizeof(Point));
+    }
+    buffer->points[buffer->size++] = p;
+}
+
+// Función que realiza la query Q en el nodo node, cuya entrada padre está a distancia parent_distance de la consulta
+// (negativa si no se conoce, como en la raíz). Las entradas que por la desigualdad triangular no pueden alcanzar la consulta
+// se descartan sin calcular su distancia. Cada punto se entrega a visit; retorna 1 si visit detuvo la consulta
+int range_search_from(Node* node, Query Q, double parent_distance, PointVisitor visit, void* ctx, int* disk_accesses) {
     Point q = Q.q; 
     double r = Q.r;
-    int num_entries = sizeof(node) / sizeof(Entry); // number of entries in the node
+    int num_entries = node->num_entries; // number of entries in the node
     Entry* entries = node->entries; // node Entry array
 
-    // If the node is a leaf, search each entry that satisfy the condition of distance.
-    // if the entry satisfies it, then increase the sol_array length and add the point to sol_array
-    if (is_leaf(node)) {
-        (*disk_accesses)++;
+    (*disk_accesses)++;
+
+    // d(q, p) >= |d(q, parent) - d(parent, p)|, so the entries where that bound exceeds cr + r are skipped
+    int candidates[num_entries + 1];
+    int num_candidates = 0;
+    if (parent_distance < 0.0 || !parent_distance_pruning) {
+        for (int i=0; i<num_entries; i++)
+            candidates[i] = i;
+        num_candidates = num_entries;
+    }
+    else {
+        // branchless compaction, since whether each entry passes is unpredictable
         for (int i=0; i<num_entries; i++) {
-            Point p = entries[i].p;
-            if(euclidian_distance(p, q) <= r) {
-                *sol_array = (Point*)realloc(*sol_array, (*array_size) + 1 * sizeof(Point));
-                (*sol_array)[*array_size] = p;
-                (*array_size)++;
+            candidates[num_candidates] = i;
+            num_candidates += fabs(parent_distance - entries[i].pd) <= entries[i].cr + r;
+        }
+    }
+    distance_computations += num_candidates;
+    distance_computations_saved += num_entries - num_candidates;
+
+    // If the node is a leaf, search each entry that satisfy the condition of distance (compared squared).
+    // if the entry satisfies it, then visit the point
+    if (is_leaf(node)) {
+        if (num_candidates == num_entries) {
+            int hits[num_entries + 1];
+            int num_hits = points_within(&q.x, &entries[0].p.x, ENTRY_STRIDE, num_entries, r * r, hits);
+            for (int k=0; k<num_hits; k++) {
+                if (visit(entries[hits[k]].p, ctx))
+                    return 1;
+            }
+        }
+        else {
+            for (int k=0; k<num_candidates; k++) {
+                Point p = entries[candidates[k]].p;
+                if (squared_distance(q, p) <= r * r && visit(p, ctx))
+                    return 1;
             }
         }
     }
     // if is not a leaf, for each entry, if satisfy this distance condition go down to check its child node 'a'
     else {
-        (*disk_accesses)++;
-        for (int i=0; i<num_entries; i++) {
-            if(euclidean_distance(entries[i].p, q) <= entries[i].cr + r){
-                range_search(entries[i].a, Q, sol_array, array_size, disk_accesses);
+        double distances[num_entries + 1];
+        if (num_candidates == num_entries) {
+            squared_distances(&q.x, &entries[0].p.x, ENTRY_STRIDE, num_entries, distances);
+        }
+        else {
+            for (int k=0; k<num_candidates; k++)
+                distances[candidates[k]] = squared_distance(q, entries[candidates[k]].p);
+        }
+        // compared without squaring: sqrt(d^2)^2 can be below d^2, so a point exactly on a covering radius would be pruned
+        for (int k=0; k<num_candidates; k++) {
+            int i = candidates[k];
+            double distance = sqrt(distances[i]);
+            if(distance <= entries[i].cr + r){
+                if (range_search_from(entries[i].a, Q, distance, visit, ctx, disk_accesses))
+                    return 1;
             }
         }
     }
+    return 0;
 }
 
-// Función que busca los puntos en la query Q del árbol node y guarda accesos a disco en la dirección disk_accesses
-Point* search_points_in_radio(Node* node, Query Q, int* disk_accesses) {
-    Point* sol_array = NULL;
-    int array_size = 0;
+// Función que entrega a callback cada punto de la query Q en el árbol node, sin guardar los resultados.
+// Si callback retorna distinto de 0 la consulta se detiene. Retorna la cantidad de accesos a disco
+int range_search_visit(Node* node, Query Q, PointVisitor callback, void* ctx) {
+    int disk_accesses = 0;
+    range_search_from(node, Q, -1.0, callback, ctx, &disk_accesses);
+    return disk_accesses;
+}
+
+// Función que agrega p al PointBuffer ctx, para juntar los puntos de una consulta en un arreglo
+int push_point_visitor(Point p, void* ctx) {
+    push_point((PointBuffer*)ctx, p);
+    return 0;
+}
+
+// Función que realiza la query Q en el árbol node, guardando los puntos en sol y calculando los accesos a disco en la dirección disk_accesses.
+// Solo escribe en sol y disk_accesses, así que varios hilos pueden consultar el mismo árbol con buffers y contadores propios
+void range_search(Node* node, Query Q, PointBuffer* sol, int* disk_accesses) {
+    range_search_from(node, Q, -1.0, push_point_visitor, sol, disk_accesses);
+}
+
+// Función que busca los puntos en la query Q del árbol node, guarda cuántos son en result_size y los accesos a disco en la dirección disk_accesses
+Point* search_points_in_radio(Node* node, Query Q, int* result_size, int* disk_accesses) {
+    PointBuffer sol = {NULL, 0, 0};
+
+    range_search(node, Q, &sol, disk_accesses);
+    *result_size = sol.size;
+    return sol.points;
+}
+
+// Función que agrega node a la pila del cursor, contándolo como un acceso a disco
+void range_cursor_push(RangeCursor* cursor, Node* node, double parent_distance) {
+    if (cursor->depth == cursor->capacity) {
+        cursor->capacity = cursor->capacity == 0 ? 16 : 2 * cursor->capacity;
+        cursor->stack = (CursorFrame*)realloc(cursor->stack, cursor->capacity * sizeof(CursorFrame));
+    }
+    CursorFrame frame = {node, 0, parent_distance};
+    cursor->stack[cursor->depth++] = frame;
+    cursor->disk_accesses++;
+}
 
-    range_search(node, Q, &sol_array, &array_size, disk_accesses);
-    return sol_array;   
+// Función que abre un cursor sobre la query Q en el árbol node. Los puntos se piden con range_cursor_next
+RangeCursor* open_range_cursor(Node* node, Query Q) {
+    RangeCursor* cursor = (RangeCursor*)malloc(sizeof(RangeCursor));
+    cursor->Q = Q;
+    cursor->stack = NULL;
+    cursor->depth = 0;
+    cursor->capacity = 0;
+    cursor->disk_accesses = 0;
+    range_cursor_push(cursor, node, -1.0);
+    return cursor;
 }
+
+// Función que guarda en p el siguiente punto de la consulta del cursor, en el mismo orden que range_search.
+// Retorna 1 si encontró un punto y 0 si la consulta terminó
+int range_cursor_next(RangeCursor* cursor, Point* p) {
+    Point q = cursor->Q.q;
+    double r = cursor->Q.r;
+
+    while (cursor->depth > 0) {
+        CursorFrame* frame = &cursor->stack[cursor->depth - 1];
+        if (frame->next == frame->node->num_entries) {
+            cursor->depth--;
+            continue;
+        }
+
+        Entry e = frame->node->entries[frame->next++];
+        if (parent_distance_pruning && frame->parent_distance >= 0.0 && fabs(frame->parent_distance - e.pd) > e.cr + r) {
+            distance_computations_saved++;
+            continue;
+        }
+        distance_computations++;
+        double distance = squared_distance(q, e.p);
+
+        if (e.a == NULL) {
+            if (distance > r * r)
+                continue;
+            *p = e.p;
+            return 1;
+        }
+        // compared without squaring, as in range_search_from
+        distance = sqrt(distance);
+        if (distance <= e.cr + r)
+            range_cursor_push(cursor, e.a, distance);
+    }
+    return 0;
+}
+
+// Función que libera el cursor, haya terminado o no su consulta
+void close_range_cursor(RangeCursor* cursor) {
+    free(cursor->stack);
+    free(cursor);
+}
+
+// Función que cuenta los puntos de la query Q en el nodo node, cuya entrada padre está a distancia parent_distance de la consulta
+int range_count_from(Node* node, Query Q, double parent_distance, int* disk_accesses) {
+    Point q = Q.q;
+    double r = Q.r;
+    int count = 0;
+
+    (*disk_accesses)++;
+    for (int i = 0; i < node->num_entries; i++) {
+        Entry e = node->entries[i];
+        if (parent_distance_pruning && parent_distance >= 0.0 && fabs(parent_distance - e.pd) > e.cr + r) {
+            distance_computations_saved++;
+            continue;
+        }
+        distance_computations++;
+        double distance = euclidean_distance(q, e.p);
+
+        if (e.a == NULL) {
+            if (distance <= r)
+                count++;
+        }
+        // the whole covering ball is inside the query, so every point of the subtree counts without visiting it
+        else if (distance + e.cr <= r) {
+            count += e.count;
+        }
+        else if (distance <= e.cr + r) {
+            count += range_count_from(e.a, Q, distance, disk_accesses);
+        }
+    }
+    return count;
+}
+
+// Función que cuenta los puntos de la query Q en el árbol node sin guardarlos, y guarda los accesos a disco en disk_accesses
+int range_count(Node* node, Query Q, int* disk_accesses) {
+    return range_count_from(node, Q, -1.0, disk_accesses);
+}
+
+// Función que marca en ctx que la consulta tiene un punto, y detiene la consulta
+int stop_at_point(Point p, void* ctx) {
+    (void)p;
+    *(int*)ctx = 1;
+    return 1;
+}
+
+// Función que retorna 1 si la query Q tiene algún punto del árbol node, deteniéndose en el primero, y guarda los accesos a disco en disk_accesses
+int range_exists(Node* node, Query Q, int* disk_accesses) {
+    int found = 0;
+    range_search_from(node, Q, -1.0, stop_at_point, &found, disk_accesses);
+    return found;
+}
+
+// Función que realiza a la vez las consultas de Qs cuyos índices están en active, recorriendo node una sola vez.
+// Los puntos de la consulta j se guardan en sols[j] y los accesos a disco compartidos en disk_accesses
+void batch_range_search(Node* node, Query* Qs, int* active, int num_active, PointBuffer* sols, int* disk_accesses) {
+    Entry* entries = node->entries; // node Entry array
+
+    (*disk_accesses)++;
+
+    // queries whose ball intersects the covering ball of the current entry
+    int* child_active = (int*)malloc(num_active * sizeof(int));
+
+    for (int i = 0; i < node->num_entries; i++) {
+        Point p = entries[i].p;
+
+        if (entries[i].a == NULL) {
+            for (int k = 0; k < num_active; k++) {
+                int j = active[k];
+                if (euclidean_distance(p, Qs[j].q) <= Qs[j].r) {
+                    push_point(&sols[j], p);
+                }
+            }
+        }
+        else {
+            int num_child_active = 0;
+            for (int k = 0; k < num_active; k++) {
+                int j = active[k];
+                if (euclidean_distance(p, Qs[j].q) <= entries[i].cr + Qs[j].r)
+                    child_active[num_child_active++] = j;
+            }
+            // the child is loaded once for every query that still reaches it
+            if (num_child_active > 0)
+                batch_range_search(entries[i].a, Qs, child_active, num_child_active, sols, disk_accesses);
+        }
+    }
+
+    free(child_active);
+}
+
+// Función que busca los puntos de las num_queries consultas de Qs en un solo recorrido del árbol node.
+// Retorna un arreglo con los puntos de cada consulta, guarda sus tamaños en result_sizes y los accesos a disco en disk_accesses
+Point** search_points_in_radio_batch(Node* node, Query* Qs, int num_queries, int* result_sizes, int* disk_accesses) {
+    PointBuffer* sols = (PointBuffer*)calloc(num_queries, sizeof(PointBuffer));
+    int* active = (int*)malloc(num_queries * sizeof(int));
+
+    for (int j = 0; j < num_queries; j++)
+        active[j] = j;
+
+    if (num_queries > 0)
+        batch_range_search(node, Qs, active, num_queries, sols, disk_accesses);
+
+    Point** sol_arrays = (Point**)malloc(num_queries * sizeof(Point*));
+    for (int j = 0; j < num_queries; j++) {
+        sol_arrays[j] = sols[j].points;
+        result_sizes[j] = sols[j].size;
+    }
+
+    free(sols);
+    free(active);
+    return sol_arrays;
+}
+
+// Función que agrega el nodo node con cota inferior key a la cola, junto a la distancia de la consulta a su entrada padre
+void node_queue_push(NodeQueue* queue, Node* node, double key, double parent_distance) {
+    if (queue->size == queue->capacity) {
+        queue->capacity = queue->capacity == 0 ? 64 : 2 * queue->capacity;
+        queue->nodes = (Node**)realloc(queue->nodes, queue->capacity * sizeof(Node*));
+        queue->keys = (double*)realloc(queue->keys, queue->capacity * sizeof(double));
+        queue->parent_distances = (double*)realloc(queue->parent_distances, queue->capacity * sizeof(double));
+    }
+
+    // sift up
+    int i = queue->size++;
+    while (i > 0 && queue->keys[(i - 1) / 2] > key) {
+        queue->nodes[i] = queue->nodes[(i - 1) / 2];
+        queue->keys[i] = queue->keys[(i - 1) / 2];
+        queue->parent_distances[i] = queue->parent_distances[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    queue->nodes[i] = node;
+    queue->keys[i] = key;
+    queue->parent_distances[i] = parent_distance;
+}
+
+// Función que saca de la cola el nodo con menor cota inferior, dejando la cota en key y la distancia a su entrada padre en parent_distance
+Node* node_queue_pop(NodeQueue* queue, double* key, double* parent_distance) {
+    Node* top = queue->nodes[0];
+    *key = queue->keys[0];
+    *parent_distance = queue->parent_distances[0];
+
+    // sift down the last element from the root
+    Node* last = queue->nodes[--queue->size];
+    double last_key = queue->keys[queue->size];
+    double last_parent_distance = queue->parent_distances[queue->size];
+    int i = 0;
+    while (2 * i + 1 < queue->size) {
+        int child = 2 * i + 1;
+        if (child + 1 < queue->size && queue->keys[child + 1] < queue->keys[child])
+            child++;
+        if (queue->keys[child] >= last_key)
+            break;
+        queue->nodes[i] = queue->nodes[child];
+        queue->keys[i] = queue->keys[child];
+        queue->parent_distances[i] = queue->parent_distances[child];
+        i = child;
+    }
+    queue->nodes[i] = last;
+    queue->keys[i] = last_key;
+    queue->parent_distances[i] = last_parent_distance;
+    return top;
+}
+
+// Función que hunde el elemento i del max-heap de vecinos heap de tamaño size
+void neighbor_sift_down(Neighbor* heap, int size, int i) {
+    Neighbor moved = heap[i];
+    while (2 * i + 1 < size) {
+        int child = 2 * i + 1;
+        if (child + 1 < size && heap[child + 1].dist > heap[child].dist)
+            child++;
+        if (heap[child].dist <= moved.dist)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = moved;
+}
+
+// Función que busca los k puntos más cercanos a q en el árbol node, recorriendo los nodos por menor cota inferior (d(q, p) - cr).
+// Retorna los puntos ordenados de menor a mayor distancia, guarda cuántos son en result_size y los accesos a disco en disk_accesses
+Point* knn_search(Node* node, Point q, int k, int* result_size, int* disk_accesses) {
+    Neighbor* best = (Neighbor*)malloc(k * sizeof(Neighbor)); // max-heap with the k closest points so far
+    int best_size = 0;
+    double radius = DBL_MAX; // distance of the k-th closest point so far, shrinks as better points are found
+
+    NodeQueue queue = {NULL, NULL, NULL, 0, 0};
+    if (k > 0)
+        node_queue_push(&queue, node, 0.0, -1.0);
+
+    while (queue.size > 0) {
+        double lower_bound;
+        double parent_distance; // negative for the root, whose entries have no parent
+        Node* current = node_queue_pop(&queue, &lower_bound, &parent_distance);
+
+        // every node left in the queue is at least this far, so none of them can improve the answer
+        if (lower_bound > radius)
+            break;
+
+        (*disk_accesses)++;
+        Entry* entries = current->entries;
+        for (int i = 0; i < current->num_entries; i++) {
+            // d(q, p) - cr >= |d(q, parent) - d(parent, p)| - cr, so the entry is skipped if that bound already exceeds radius
+            if (parent_distance_pruning && parent_distance >= 0.0 && fabs(parent_distance - entries[i].pd) - entries[i].cr > radius) {
+                distance_computations_saved++;
+                continue;
+            }
+            double distance = euclidean_distance(entries[i].p, q);
+            distance_computations++;
+
+            if (entries[i].a == NULL) {
+                if (best_size < k) {
+                    // sift up the new point
+                    int j = best_size++;
+                    while (j > 0 && best[(j - 1) / 2].dist < distance) {
+                        best[j] = best[(j - 1) / 2];
+                        j = (j - 1) / 2;
+                    }
+                    best[j].p = entries[i].p;
+                    best[j].dist = distance;
+                }
+                else if (distance < radius) {
+                    best[0].p = entries[i].p;
+                    best[0].dist = distance;
+                    neighbor_sift_down(best, best_size, 0);
+                }
+                if (best_size == k)
+                    radius = best[0].dist;
+            }
+            else {
+                double child_bound = distance - entries[i].cr;
+                if (child_bound < 0.0)
+                    child_bound = 0.0;
+                if (child_bound <= radius)
+                    node_queue_push(&queue, entries[i].a, child_bound, distance);
+            }
+        }
+    }
+
+    free(queue.nodes);
+    free(queue.keys);
+    free(queue.parent_distances);
+
+    // heap sort the neighbors to return them by increasing distance
+    Point* sol_array = (Point*)malloc(best_size * sizeof(Point));
+    for (int size = best_size; size > 0; size--) {
+        sol_array[size - 1] = best[0].p;
+        best[0] = best[size - 1];
+        neighbor_sift_down(best, size - 1, 0);
+    }
+    free(best);
+
+    *result_size = best_size;
+    return sol_array;
+}
+
+#endif
@@ -0,0 +1,736 @@
+#ifndef MTREE_HPP
+#define MTREE_HPP
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Cantidad de acumuladores independientes de las métricas. Sin -ffast-math el compilador no puede reordenar una suma
+// de punto flotante, pero sí vectorizar METRIC_LANES sumas separadas que se combinan al final
+constexpr std::size_t METRIC_LANES = 8;
+
+// Función que combina term(a[i], b[i]) de todas las coordenadas con combine, repartiéndolas en METRIC_LANES acumuladores.
+// Con Dim fijo el ciclo se desenrolla completo
+template <std::size_t Dim, typename Scalar, typename Term, typename Combine>
+inline Scalar laneReduce(const std::array<Scalar, Dim>& a, const std::array<Scalar, Dim>& b, Term term, Combine combine) {
+    Scalar lanes[METRIC_LANES] = {};
+    for (std::size_t i = 0; i < Dim; i++)
+        lanes[i % METRIC_LANES] = combine(lanes[i % METRIC_LANES], term(a[i], b[i]));
+    Scalar result = lanes[0];
+    for (std::size_t l = 1; l < METRIC_LANES; l++)
+        result = combine(result, lanes[l]);
+    return result;
+}
+
+// Métrica euclidiana (L2)
+struct L2Metric {
+    template <std::size_t Dim, typename Scalar>
+    static Scalar distance(const std::array<Scalar, Dim>& a, const std::array<Scalar, Dim>& b) {
+        Scalar sum = laneReduce(a, b, [](Scalar x, Scalar y) { Scalar d = x - y; return d * d; },
+                                [](Scalar s, Scalar t) { return s + t; });
+        return std::sqrt(sum);
+    }
+};
+
+// Métrica de Manhattan (L1)
+struct L1Metric {
+    template <std::size_t Dim, typename Scalar>
+    static Scalar distance(const std::array<Scalar, Dim>& a, const std::array<Scalar, Dim>& b) {
+        return laneReduce(a, b, [](Scalar x, Scalar y) { return std::abs(x - y); },
+                          [](Scalar s, Scalar t) { return s + t; });
+    }
+};
+
+// Métrica de Chebyshev (L∞)
+struct LInfMetric {
+    template <std::size_t Dim, typename Scalar>
+    static Scalar distance(const std::array<Scalar, Dim>& a, const std::array<Scalar, Dim>& b) {
+        // the lanes start at 0, which is below every |x - y|
+        return laneReduce(a, b, [](Scalar x, Scalar y) { return std::abs(x - y); },
+                          [](Scalar s, Scalar t) { return s > t ? s : t; });
+    }
+};
+
+// Distancia coseno como el ángulo entre los vectores. A diferencia de 1 - cos(a, b) cumple la desigualdad triangular,
+// que el M-tree necesita para podar. El vector nulo queda a pi / 2 de todos los demás
+struct CosineMetric {
+    template <std::size_t Dim, typename Scalar>
+    static Scalar distance(const std::array<Scalar, Dim>& a, const std::array<Scalar, Dim>& b) {
+        auto product = [](Scalar x, Scalar y) { return x * y; };
+        auto sum = [](Scalar s, Scalar t) { return s + t; };
+        Scalar dot = laneReduce(a, b, product, sum);
+        Scalar norm_a = laneReduce(a, a, product, sum);
+        Scalar norm_b = laneReduce(b, b, product, sum);
+        if (norm_a == 0 || norm_b == 0)
+            return norm_a == norm_b ? Scalar(0) : Scalar(std::acos(0.0));
+        Scalar cosine = dot / std::sqrt(norm_a * norm_b);
+        cosine = std::min(Scalar(1), std::max(Scalar(-1), cosine)); // rounding can leave it slightly outside [-1, 1]
+        return std::acos(cosine);
+    }
+};
+
+// Clase que representa un M-tree de puntos de Dim coordenadas de tipo Scalar con la métrica Metric, construido con
+// el método de Ciaccia-Patella o de Sexton-Swinbank como en mtree.c. B se calcula para que un nodo ocupe una página de PageSize bytes.
+// Con PageSize 0 la página es la menor potencia de dos desde 4096 bytes donde caben 4 entradas
+template <std::size_t Dim, typename Scalar = double, typename Metric = L2Metric, std::size_t PageSize = 0>
+class MTree {
+public:
+    typedef std::array<Scalar, Dim> Point;
+    struct Node;
+
+    // Estructura que representa una entrada
+    struct Entry {
+        Point p;
+        Scalar cr;
+        Node* a; // nullptr if the entry is a point
+    };
+
+    // Función que calcula el tamaño de página por defecto
+    static constexpr std::size_t defaultPageSize() {
+        std::size_t size = 4096;
+        while (size < 4 * sizeof(Entry))
+            size *= 2;
+        return size;
+    }
+
+    // Tamaño de la página de un nodo
+    static constexpr std::size_t pageSize = PageSize != 0 ? PageSize : defaultPageSize();
+
+    // Cantidad máxima de entradas de un nodo, y mínima de los nodos que crean los métodos de construcción
+    static constexpr int B = (int)(pageSize / sizeof(Entry));
+    static constexpr int b = B / 2;
+    static_assert(B >= 4, "Una página debe tener espacio para al menos 4 entradas");
+
+    // Estructura que representa un nodo
+    struct Node {
+        Entry entries[B];
+        int num_entries = 0;
+    };
+
+    // Constructor de un árbol vacío
+    MTree() : root(createNode()) {}
+
+    // Función que calcula la distancia entre p1 y p2 con la métrica del árbol
+    static Scalar distance(const Point& p1, const Point& p2) {
+        return Metric::distance(p1, p2);
+    }
+
+    // Función que construye un M-tree con el método de Ciaccia-Patella, usando la semilla seed para las elecciones aleatorias
+    static MTree ciacciaPatella(const std::vector<Point>& P, unsigned int seed = std::random_device()()) {
+        MTree tree;
+        std::mt19937 rng(seed);
+        tree.root = tree.cpBuild(P, rng);
+        return tree;
+    }
+
+    // Función que construye un M-tree con el método de Sexton-Swinbank
+    static MTree sextonSwinbank(const std::vector<Point>& P) {
+        MTree tree;
+        tree.root = tree.ssBuild(P);
+        return tree;
+    }
+
+    // Función que busca los puntos a distancia a lo más r de q, sumando los accesos a disco en diskAccesses
+    std::vector<Point> rangeSearch(const Point& q, Scalar r, int* diskAccesses = nullptr) const {
+        std::vector<Point> sol;
+        rangeSearch(root, q, r, sol, diskAccesses);
+        return sol;
+    }
+
+    // Función que busca los k puntos más cercanos a q, recorriendo los nodos por menor cota inferior (d(q, p) - cr).
+    // Retorna los puntos ordenados de menor a mayor distancia
+    std::vector<Point> knnSearch(const Point& q, int k, int* diskAccesses = nullptr) const {
+        typedef std::pair<Scalar, const Node*> QueueItem;
+        typedef std::pair<Scalar, Point> Neighbor;
+        auto farther = [](const Neighbor& n1, const Neighbor& n2) { return n1.first < n2.first; };
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+        std::priority_queue<Neighbor, std::vector<Neighbor>, decltype(farther)> best(farther); // max-heap with the k closest points so far
+        Scalar radius = std::numeric_limits<Scalar>::max();
+
+        if (k > 0)
+            queue.push(QueueItem(Scalar(0), root));
+        while (!queue.empty()) {
+            QueueItem top = queue.top();
+            queue.pop();
+            // every node left in the queue is at least this far, so none of them can improve the answer
+            if (top.first > radius)
+                break;
+
+            if (diskAccesses != nullptr)
+                (*diskAccesses)++;
+            const Node* node = top.second;
+            for (int i = 0; i < node->num_entries; i++) {
+                const Entry& e = node->entries[i];
+                Scalar d = distance(q, e.p);
+                if (e.a == nullptr) {
+                    if ((int)best.size() < k) {
+                        best.push(Neighbor(d, e.p));
+                    }
+                    else if (d < radius) {
+                        best.pop();
+                        best.push(Neighbor(d, e.p));
+                    }
+                    if ((int)best.size() == k)
+                        radius = best.top().first;
+                }
+                else {
+                    Scalar bound = std::max(Scalar(0), d - e.cr);
+                    if (bound <= radius)
+                        queue.push(QueueItem(bound, e.a));
+                }
+            }
+        }
+
+        std::vector<Point> sol(best.size());
+        for (std::size_t i = sol.size(); i > 0; i--) {
+            sol[i - 1] = best.top().second;
+            best.pop();
+        }
+        return sol;
+    }
+
+    // Función que retorna la raíz del árbol
+    const Node* getRoot() const {
+        return root;
+    }
+
+    // Función que retorna la altura del árbol
+    int height() const {
+        return treeHeight(root);
+    }
+
+private:
+    std::vector<std::unique_ptr<Node>> nodes; // every node created for the tree, freed with it
+    Node* root;
+
+    // Estructura que representa un subárbol de CP junto al punto que lo representa en F
+    struct Subtree {
+        Point p;
+        Node* n;
+        int h;
+    };
+
+    // Estructura que representa un cluster de SS: sus puntos, la entrada a la que corresponde cada uno,
+    // la excentricidad de cada punto (su mayor distancia a otro punto del cluster) y el índice de su medoide
+    struct Cluster {
+        std::vector<Point> points;
+        std::vector<int> ids;
+        std::vector<Scalar> ecc;
+        int medoid = 0;
+    };
+
+    // Función que crea un nodo, que se libera junto al árbol
+    Node* createNode() {
+        nodes.emplace_back(new Node());
+        return nodes.back().get();
+    }
+
+    // Función que agrega entry a las entradas de node
+    static void insertEntry(Node* node, const Entry& entry) {
+        node->entries[node->num_entries++] = entry;
+    }
+
+    // Función que realiza la query (q, r) en el nodo node, guardando los puntos en sol
+    static void rangeSearch(const Node* node, const Point& q, Scalar r, std::vector<Point>& sol, int* diskAccesses) {
+        if (diskAccesses != nullptr)
+            (*diskAccesses)++;
+        for (int i = 0; i < node->num_entries; i++) {
+            const Entry& e = node->entries[i];
+            Scalar d = distance(q, e.p);
+            if (e.a == nullptr) {
+                if (d <= r)
+                    sol.push_back(e.p);
+            }
+            else if (d <= e.cr + r) {
+                rangeSearch(e.a, q, r, sol, diskAccesses);
+            }
+        }
+    }
+
+    // Función que calcula la altura del subárbol node (0 si es nullptr)
+    static int treeHeight(const Node* node) {
+        if (node == nullptr)
+            return 0;
+        int max_subtree_height = 0;
+        for (int i = 0; i < node->num_entries; i++)
+            max_subtree_height = std::max(max_subtree_height, treeHeight(node->entries[i].a));
+        return 1 + max_subtree_height;
+    }
+
+    // Función que retorna el índice del punto de F más cercano a p (el primero si hay empates)
+    static int nearestPoint(const Point& p, const std::vector<Point>& F) {
+        int nearest = 0;
+        Scalar nearest_distance = std::numeric_limits<Scalar>::max();
+        for (std::size_t i = 0; i < F.size(); i++) {
+            Scalar d = distance(p, F[i]);
+            if (d < nearest_distance) {
+                nearest_distance = d;
+                nearest = (int)i;
+            }
+        }
+        return nearest;
+    }
+
+    // Función que borra de F la primera aparición de p
+    static void deletePointInF(std::vector<Point>& F, const Point& p) {
+        auto it = std::find(F.begin(), F.end(), p);
+        if (it != F.end())
+            F.erase(it);
+    }
+
+    // Función que agrega a T_prime los subárboles de node (de altura node_height) que tienen altura h, y sus puntos a F
+    static void addSubtreesOfHeight(Node* node, int node_height, int h, std::vector<Subtree>& T_prime, std::vector<Point>& F) {
+        for (int i = 0; i < node->num_entries; i++) {
+            const Entry& e = node->entries[i];
+            // the tree is balanced, so every subtree one level below has height node_height - 1
+            if (node_height - 1 == h) {
+                T_prime.push_back(Subtree{e.p, e.a, h});
+                F.push_back(e.p);
+            }
+            else {
+                addSubtreesOfHeight(e.a, node_height - 1, h, T_prime, F);
+            }
+        }
+    }
+
+    // Función que cuelga el subárbol Tj de la hoja de Tsup cuyo punto es el de Tj. levels es la altura de Tsup antes de unir
+    static void joinTj(Node* Tsup, const Subtree& Tj, bool& already_inserted, int levels) {
+        for (int i = 0; i < Tsup->num_entries && !already_inserted; i++) {
+            Entry& e = Tsup->entries[i];
+            if (levels == 1) {
+                if (e.p == Tj.p) {
+                    e.a = Tj.n;
+                    already_inserted = true;
+                }
+            }
+            else {
+                joinTj(e.a, Tj, already_inserted, levels - 1);
+            }
+        }
+    }
+
+    // Función que calcula el radio cobertor de cada entrada del subárbol node
+    static void setCoveringRadius(Node* node) {
+        for (int i = 0; i < node->num_entries; i++) {
+            Entry& e = node->entries[i];
+            e.cr = 0;
+            if (e.a == nullptr)
+                continue;
+            setCoveringRadius(e.a); // the covering radius of the subtree are set first
+            for (int j = 0; j < e.a->num_entries; j++)
+                e.cr = std::max(e.cr, distance(e.p, e.a->entries[j].p) + e.a->entries[j].cr);
+        }
+    }
+
+    // Función que construye el subárbol de P con el algoritmo CP, siguiendo los pasos de cpBuild en cp.c
+    Node* cpBuild(const std::vector<Point>& P, std::mt19937& rng) {
+        int P_size = (int)P.size();
+
+        // STEP 1
+        if (P_size <= B) {
+            Node* leaf = createNode();
+            for (const Point& p : P)
+                insertEntry(leaf, Entry{p, 0, nullptr});
+            return leaf;
+        }
+
+        int K = std::min(B, (P_size + B - 1) / B);
+        std::vector<Point> F;
+        std::vector<Point> samples;
+        std::vector<std::vector<Point>> subsets;
+        std::vector<char> working;
+        std::vector<int> indices(P_size);
+
+        do {
+            // STEP 2: K distinct samples, from a partial shuffle of the indices
+            std::iota(indices.begin(), indices.end(), 0);
+            for (int i = 0; i < K; i++) {
+                std::uniform_int_distribution<int> pick(i, P_size - 1);
+                std::swap(indices[i], indices[pick(rng)]);
+            }
+            samples.assign(K, Point());
+            for (int i = 0; i < K; i++)
+                samples[i] = P[indices[i]];
+            F = samples;
+
+            // STEP 3
+            subsets.assign(K, std::vector<Point>());
+            working.assign(K, 1);
+            for (const Point& p : P)
+                subsets[nearestPoint(p, samples)].push_back(p);
+
+            // STEP 4: the points of the subsets with fewer than b points go to the nearest sample still working
+            for (int j = 0; j < K; j++) {
+                if ((int)subsets[j].size() >= b)
+                    continue;
+                working[j] = 0;
+                deletePointInF(F, samples[j]);
+                for (const Point& p : subsets[j]) {
+                    int nearest = -1;
+                    Scalar nearest_distance = std::numeric_limits<Scalar>::max();
+                    for (int l = 0; l < K; l++) {
+                        Scalar d = distance(p, samples[l]);
+                        if (working[l] && d < nearest_distance) {
+                            nearest_distance = d;
+                            nearest = l;
+                        }
+                    }
+                    subsets[nearest].push_back(p);
+                }
+            }
+        } while (F.size() == 1); // STEP 5
+
+        // STEPS 6 and 7
+        std::vector<Subtree> T;
+        for (int j = 0; j < K; j++) {
+            if (!working[j])
+                continue;
+            Node* Tj = cpBuild(subsets[j], rng);
+            if (Tj->num_entries < b) {
+                // the root is too small, so its subtrees are used instead
+                deletePointInF(F, samples[j]);
+                for (int i = 0; i < Tj->num_entries; i++) {
+                    T.push_back(Subtree{Tj->entries[i].p, Tj->entries[i].a, 0});
+                    F.push_back(Tj->entries[i].p);
+                }
+            }
+            else {
+                T.push_back(Subtree{samples[j], Tj, 0});
+            }
+        }
+
+        // STEP 8
+        int h = INT_MAX;
+        for (Subtree& Tj : T) {
+            Tj.h = treeHeight(Tj.n);
+            h = std::min(h, Tj.h);
+        }
+
+        // STEP 9
+        std::vector<Subtree> T_prime;
+        for (const Subtree& Tj : T) {
+            if (Tj.h == h) {
+                T_prime.push_back(Tj);
+            }
+            else {
+                deletePointInF(F, Tj.p);
+                addSubtreesOfHeight(Tj.n, Tj.h, h, T_prime, F);
+            }
+        }
+
+        // STEP 10
+        Node* T_sup = cpBuild(F, rng);
+
+        // STEP 11
+        int T_sup_height = treeHeight(T_sup);
+        for (const Subtree& Tj : T_prime) {
+            bool inserted = false;
+            joinTj(T_sup, Tj, inserted, T_sup_height);
+        }
+
+        // STEP 12
+        setCoveringRadius(T_sup);
+        return T_sup;
+    }
+
+    // Función que calcula la excentricidad de cada punto del cluster y su medoide
+    static void computeEccentricities(Cluster& c) {
+        int n = (int)c.points.size();
+        c.ecc.assign(n, Scalar(0));
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                Scalar d = distance(c.points[i], c.points[j]);
+                c.ecc[i] = std::max(c.ecc[i], d);
+                c.ecc[j] = std::max(c.ecc[j], d);
+            }
+        }
+        selectMedoid(c);
+    }
+
+    // Función que elige como medoide el punto de menor excentricidad
+    static void selectMedoid(Cluster& c) {
+        c.medoid = (int)(std::min_element(c.ecc.begin(), c.ecc.end()) - c.ecc.begin());
+    }
+
+    // Función que calcula la distancia entre los medoides de dos clusters
+    static Scalar clusterDist(const Cluster& c1, const Cluster& c2) {
+        return distance(c1.points[c1.medoid], c2.points[c2.medoid]);
+    }
+
+    // Función que une dos clusters. La excentricidad de cada punto solo puede crecer con las distancias al otro cluster
+    static Cluster mergeClusters(const Cluster& c1, const Cluster& c2) {
+        Cluster merged;
+        merged.points = c1.points;
+        merged.points.insert(merged.points.end(), c2.points.begin(), c2.points.end());
+        merged.ids = c1.ids;
+        merged.ids.insert(merged.ids.end(), c2.ids.begin(), c2.ids.end());
+        merged.ecc = c1.ecc;
+        merged.ecc.insert(merged.ecc.end(), c2.ecc.begin(), c2.ecc.end());
+
+        int n1 = (int)c1.points.size();
+        for (int i = 0; i < n1; i++) {
+            for (int j = 0; j < (int)c2.points.size(); j++) {
+                Scalar d = distance(c1.points[i], c2.points[j]);
+                merged.ecc[i] = std::max(merged.ecc[i], d);
+                merged.ecc[n1 + j] = std::max(merged.ecc[n1 + j], d);
+            }
+        }
+        if (!merged.points.empty())
+            selectMedoid(merged);
+        return merged;
+    }
+
+    // Función que divide un cluster en dos con la política MinMax: para cada par de puntos reparte los demás por turnos,
+    // cada uno tomando su punto libre más cercano, y se queda con el par cuyo mayor radio es menor
+    static std::pair<Cluster, Cluster> minMaxSplitPolicy(const Cluster& c) {
+        int n = (int)c.points.size();
+        std::vector<Scalar> dist((std::size_t)n * n);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                dist[(std::size_t)i * n + j] = distance(c.points[i], c.points[j]);
+
+        // row i: every point sorted by distance to point i
+        std::vector<int> order((std::size_t)n * n);
+        for (int i = 0; i < n; i++) {
+            int* row = &order[(std::size_t)i * n];
+            std::iota(row, row + n, 0);
+            std::stable_sort(row, row + n, [&](int x, int y) { return dist[(std::size_t)i * n + x] < dist[(std::size_t)i * n + y]; });
+        }
+
+        Scalar best = std::numeric_limits<Scalar>::max();
+        std::vector<char> side(n), best_side;
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                std::fill(side.begin(), side.end(), -1);
+                side[i] = 0;
+                side[j] = 1;
+                int center[2] = {i, j};
+                int next[2] = {0, 0};
+                Scalar radius[2] = {0, 0};
+                for (int taken = 2, turn = 0; taken < n; taken++, turn = 1 - turn) {
+                    const int* row = &order[(std::size_t)center[turn] * n];
+                    while (side[row[next[turn]]] != -1)
+                        next[turn]++;
+                    int k = row[next[turn]];
+                    side[k] = (char)turn;
+                    radius[turn] = std::max(radius[turn], dist[(std::size_t)center[turn] * n + k]);
+                }
+                Scalar worst = std::max(radius[0], radius[1]);
+                if (worst < best) {
+                    best = worst;
+                    best_side = side;
+                }
+            }
+        }
+
+        std::pair<Cluster, Cluster> halves;
+        for (int k = 0; k < n; k++) {
+            Cluster& half = best_side[k] == 0 ? halves.first : halves.second;
+            half.points.push_back(c.points[k]);
+            half.ids.push_back(c.ids[k]);
+        }
+        computeEccentricities(halves.first);
+        computeEccentricities(halves.second);
+        return halves;
+    }
+
+    // Función que agrupa los puntos de C_in en clusters de a lo más B puntos, siguiendo la función cluster de ss.c
+    static std::vector<Cluster> cluster(const std::vector<Point>& points, const std::vector<int>& ids) {
+        /* 1. */
+        std::vector<Cluster> C_out;
+        int n = (int)points.size();
+        std::vector<Cluster> C(n);
+        /* 2. */
+        for (int i = 0; i < n; i++) {
+            C[i].points.push_back(points[i]);
+            C[i].ids.push_back(ids[i]);
+            C[i].ecc.push_back(Scalar(0));
+        }
+
+        // every alive cluster keeps its nearest neighbor, so the closest pair is the one with the smallest nn_dist.
+        // The medoids are kept in their own array so that the scans for nearest neighbors read contiguous memory
+        std::vector<int> alive(n), nn(n, -1);
+        std::vector<Scalar> nn_dist(n);
+        std::vector<Point> medoids(points);
+        std::iota(alive.begin(), alive.end(), 0);
+        auto findNearest = [&](int i) {
+            nn[i] = -1;
+            nn_dist[i] = std::numeric_limits<Scalar>::max();
+            for (int j : alive) {
+                if (j == i)
+                    continue;
+                Scalar d = distance(medoids[i], medoids[j]);
+                if (d < nn_dist[i]) {
+                    nn_dist[i] = d;
+                    nn[i] = j;
+                }
+            }
+        };
+        auto removeAlive = [&](int i) {
+            alive.erase(std::find(alive.begin(), alive.end(), i));
+        };
+        for (int i = 0; i < n; i++)
+            findNearest(i);
+
+        /* 3. */
+        while (alive.size() > 1) {
+            int closest = alive[0];
+            for (int i : alive) {
+                if (nn_dist[i] < nn_dist[closest])
+                    closest = i;
+            }
+            int c1 = closest;
+            int c2 = nn[closest];
+            if (C[c1].points.size() < C[c2].points.size())
+                std::swap(c1, c2);
+
+            if ((int)(C[c1].points.size() + C[c2].points.size()) <= B) {
+                C[c1] = mergeClusters(C[c1], C[c2]);
+                C[c2] = Cluster();
+                medoids[c1] = C[c1].points[C[c1].medoid];
+                removeAlive(c2);
+                std::vector<int> stale;
+                for (int i : alive) {
+                    if (i == c1)
+                        continue;
+                    if (nn[i] == c1 || nn[i] == c2) {
+                        stale.push_back(i);
+                    }
+                    else {
+                        Scalar d = distance(medoids[i], medoids[c1]);
+                        if (d < nn_dist[i]) {
+                            nn_dist[i] = d;
+                            nn[i] = c1;
+                        }
+                    }
+                }
+                for (int i : stale)
+                    findNearest(i);
+                findNearest(c1);
+            }
+            else {
+                removeAlive(c1);
+                C_out.push_back(std::move(C[c1]));
+                for (int i : alive) {
+                    if (nn[i] == c1)
+                        findNearest(i);
+                }
+            }
+        }
+
+        /* 4. */
+        Cluster c = std::move(C[alive[0]]);
+        /* 5. */
+        Cluster c_prima;
+        if (!C_out.empty()) {
+            int nearest = 0;
+            for (int i = 1; i < (int)C_out.size(); i++) {
+                if (clusterDist(c, C_out[i]) < clusterDist(c, C_out[nearest]))
+                    nearest = i;
+            }
+            c_prima = std::move(C_out[nearest]);
+            C_out.erase(C_out.begin() + nearest);
+        }
+        /* 6. */
+        Cluster c_union_prima = mergeClusters(c, c_prima);
+        if ((int)c_union_prima.points.size() <= B) {
+            C_out.push_back(std::move(c_union_prima));
+        }
+        else {
+            std::pair<Cluster, Cluster> halves = minMaxSplitPolicy(c_union_prima);
+            C_out.push_back(std::move(halves.first));
+            C_out.push_back(std::move(halves.second));
+        }
+        /* 7. */
+        return C_out;
+    }
+
+    // Función que crea una hoja con los puntos del cluster, y retorna la entrada que la apunta desde su medoide
+    Entry outputHoja(const Cluster& c) {
+        const Point& g = c.points[c.medoid];
+        Scalar r = 0;
+        Node* leaf = createNode();
+        for (const Point& p : c.points) {
+            insertEntry(leaf, Entry{p, 0, nullptr});
+            r = std::max(r, distance(g, p));
+        }
+        return Entry{g, r, leaf};
+    }
+
+    // Función que crea un nodo interno con las entradas C_mra, y retorna la entrada que lo apunta desde el medoide de sus puntos
+    Entry outputInterno(const std::vector<Entry>& C_mra) {
+        Cluster c;
+        for (const Entry& e : C_mra)
+            c.points.push_back(e.p);
+        computeEccentricities(c);
+        const Point& G = c.points[c.medoid];
+        Scalar R = 0;
+        Node* node = createNode();
+        for (const Entry& e : C_mra) {
+            insertEntry(node, e);
+            R = std::max(R, distance(G, e.p) + e.cr);
+        }
+        return Entry{G, R, node};
+    }
+
+    // Función que construye el árbol de P con el algoritmo SS, siguiendo los pasos de sextonSwinbank en ss.c
+    Node* ssBuild(const std::vector<Point>& P) {
+        int P_size = (int)P.size();
+        std::vector<int> ids(P_size);
+        std::iota(ids.begin(), ids.end(), 0);
+
+        /* 1. */
+        if (P_size <= B) {
+            Cluster c;
+            c.points = P;
+            if (P.empty()) {
+                return createNode();
+            }
+            computeEccentricities(c);
+            return outputHoja(c).a;
+        }
+        /* 2. */
+        std::vector<Cluster> C_out = cluster(P, ids);
+        /* 3. */
+        std::vector<Entry> C;
+        for (const Cluster& c : C_out)
+            C.push_back(outputHoja(c));
+
+        /* 4. */
+        while ((int)C.size() > B) {
+            /* 4.1 */
+            std::vector<Point> points;
+            std::vector<int> entry_ids;
+            for (int i = 0; i < (int)C.size(); i++) {
+                points.push_back(C[i].p);
+                entry_ids.push_back(i);
+            }
+            C_out = cluster(points, entry_ids);
+            /* 4.2: every cluster knows which entries its points came from */
+            std::vector<Entry> next;
+            for (const Cluster& c : C_out) {
+                std::vector<Entry> s;
+                for (int id : c.ids)
+                    s.push_back(C[id]);
+                /* 4.4 */
+                next.push_back(outputInterno(s));
+            }
+            /* 4.3 */
+            C = std::move(next);
+        }
+        /* 5. */
+        return outputInterno(C).a;
+    }
+};
+
+#endif
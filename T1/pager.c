@@ -0,0 +1,303 @@
+#ifndef PAGER_C
+#define PAGER_C
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "mtree.c"
+
+#define DISK_PAGE_SIZE 4096
+#define PAGE_MAGIC "MTREEPG1"
+
+typedef struct diskentry DiskEntry;
+typedef struct pageheader PageHeader;
+typedef struct pagecache PageCache;
+typedef struct pagedtree PagedTree;
+
+// Estructura que representa una entrada guardada en una página. En vez del puntero al hijo se guarda
+// el número de página del hijo (0 si la entrada es de una hoja) y la cantidad de entradas de esa página
+struct diskentry {
+    Point p;
+    double cr;
+    uint32_t child;
+    int32_t child_entries;
+};
+
+// Cantidad de entradas que caben en una página
+#define PAGE_ENTRIES (DISK_PAGE_SIZE / sizeof(DiskEntry))
+
+// Estructura de la página 0 del archivo, describe el árbol guardado
+struct pageheader {
+    char magic[8];
+    uint32_t page_size;
+    uint32_t page_count;
+    uint32_t root_page;
+    int32_t root_entries;
+};
+
+// Estructura que representa el cache de páginas, con reemplazo LRU
+struct pagecache {
+    int capacity; // número de páginas que se mantienen en memoria
+    int used; // número de slots ocupados
+    DiskEntry* frames; // capacity páginas contiguas
+    uint32_t* frame_page; // página cargada en cada slot
+    int* prev; // lista doblemente enlazada de slots, de más a menos reciente
+    int* next;
+    int head, tail;
+    int* slot_of_page; // slot de cada página, -1 si no está en el cache
+    long hits, misses, evictions;
+};
+
+// Estructura que representa un árbol guardado en un archivo de páginas
+struct pagedtree {
+    int fd;
+    PageHeader header;
+    PageCache cache;
+};
+
+// Función que escribe el nodo node en la página page_id, asignando páginas a sus hijos a partir de *next_page
+int write_node_page(int fd, Node* node, uint32_t page_id, uint32_t* next_page) {
+    DiskEntry page[PAGE_ENTRIES];
+    uint32_t first_child = *next_page;
+
+    memset(page, 0, sizeof(page));
+
+    // children of the same node get consecutive pages
+    for (int i = 0; i < node->num_entries; i++) {
+        Entry e = node->entries[i];
+        page[i].p = e.p;
+        page[i].cr = e.cr;
+        if (e.a != NULL) {
+            page[i].child = (*next_page)++;
+            page[i].child_entries = e.a->num_entries;
+        }
+    }
+
+    if (pwrite(fd, page, DISK_PAGE_SIZE, (off_t)page_id * DISK_PAGE_SIZE) != DISK_PAGE_SIZE)
+        return -1;
+
+    uint32_t child_page = first_child;
+    for (int i = 0; i < node->num_entries; i++) {
+        Node* a = node->entries[i].a;
+        if (a == NULL)
+            continue;
+        if (a->num_entries > (int)PAGE_ENTRIES)
+            return -1;
+        if (write_node_page(fd, a, child_page++, next_page) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Función que escribe la página 0 de un archivo de páginas, con la marca magic y la raíz en la página 1, y cierra el archivo.
+// Retorna 0 si tuvo éxito y -1 si no
+int finish_page_file(int fd, const char* magic, uint32_t page_count, int root_entries) {
+    char first_page[DISK_PAGE_SIZE];
+    memset(first_page, 0, sizeof(first_page));
+    PageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.page_size = DISK_PAGE_SIZE;
+    header.page_count = page_count;
+    header.root_page = 1;
+    header.root_entries = root_entries;
+    memcpy(first_page, &header, sizeof(header));
+
+    int ok = pwrite(fd, first_page, DISK_PAGE_SIZE, 0) == DISK_PAGE_SIZE;
+    ok = fsync(fd) == 0 && ok;
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+// Función que guarda el árbol root en el archivo path, un nodo por página. Retorna 0 si tuvo éxito y -1 si no, por ejemplo
+// si el árbol tiene nodos de más de PAGE_ENTRIES entradas
+int write_paged_tree(Node* root, const char* path) {
+    if (root->num_entries > (int)PAGE_ENTRIES)
+        return -1;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+
+    uint32_t next_page = 2; // page 0 is the header and page 1 the root
+    if (write_node_page(fd, root, 1, &next_page) != 0) {
+        close(fd);
+        return -1;
+    }
+    return finish_page_file(fd, PAGE_MAGIC, next_page, root->num_entries);
+}
+
+// Función que abre un archivo de páginas cuyo encabezado tiene la marca magic, con un cache de cache_pages páginas (al menos 1).
+// Retorna NULL si el archivo no es válido, incluyendo encabezados con más páginas que las que tiene el archivo
+PagedTree* open_page_file(const char* path, int cache_pages, const char* magic) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    PageHeader header;
+    struct stat st;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        memcmp(header.magic, magic, sizeof(header.magic)) != 0 ||
+        header.page_size != DISK_PAGE_SIZE ||
+        fstat(fd, &st) != 0 ||
+        (uint64_t)header.page_count * DISK_PAGE_SIZE > (uint64_t)st.st_size ||
+        header.root_page == 0 || header.root_page >= header.page_count) {
+        close(fd);
+        return NULL;
+    }
+
+    if (cache_pages < 1)
+        cache_pages = 1;
+
+    PagedTree* tree = (PagedTree*)malloc(sizeof(PagedTree));
+    tree->fd = fd;
+    tree->header = header;
+
+    PageCache* cache = &tree->cache;
+    cache->capacity = cache_pages;
+    cache->used = 0;
+    cache->frames = (DiskEntry*)malloc((size_t)cache_pages * DISK_PAGE_SIZE);
+    cache->frame_page = (uint32_t*)malloc(cache_pages * sizeof(uint32_t));
+    cache->prev = (int*)malloc(cache_pages * sizeof(int));
+    cache->next = (int*)malloc(cache_pages * sizeof(int));
+    cache->head = -1;
+    cache->tail = -1;
+    cache->slot_of_page = (int*)malloc(header.page_count * sizeof(int));
+    for (uint32_t i = 0; i < header.page_count; i++)
+        cache->slot_of_page[i] = -1;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+
+    return tree;
+}
+
+// Función que abre un árbol guardado con write_paged_tree, con un cache de cache_pages páginas (al menos 1)
+PagedTree* open_paged_tree(const char* path, int cache_pages) {
+    return open_page_file(path, cache_pages, PAGE_MAGIC);
+}
+
+// Función que cierra el archivo del árbol y libera su cache
+void close_paged_tree(PagedTree* tree) {
+    PageCache* cache = &tree->cache;
+    close(tree->fd);
+    free(cache->frames);
+    free(cache->frame_page);
+    free(cache->prev);
+    free(cache->next);
+    free(cache->slot_of_page);
+    free(tree);
+}
+
+// Función que saca el slot s de la lista LRU
+void lru_unlink(PageCache* cache, int s) {
+    if (cache->prev[s] != -1)
+        cache->next[cache->prev[s]] = cache->next[s];
+    else
+        cache->head = cache->next[s];
+    if (cache->next[s] != -1)
+        cache->prev[cache->next[s]] = cache->prev[s];
+    else
+        cache->tail = cache->prev[s];
+}
+
+// Función que deja el slot s como el más reciente de la lista LRU
+void lru_push_front(PageCache* cache, int s) {
+    cache->prev[s] = -1;
+    cache->next[s] = cache->head;
+    if (cache->head != -1)
+        cache->prev[cache->head] = s;
+    cache->head = s;
+    if (cache->tail == -1)
+        cache->tail = s;
+}
+
+// Función que retorna las entradas de la página page, leyéndola del archivo con pread si no está en el cache.
+// Cada lectura real suma un acceso en disk_accesses. El puntero es válido hasta el siguiente fetch_page
+DiskEntry* fetch_page(PagedTree* tree, uint32_t page, int* disk_accesses) {
+    PageCache* cache = &tree->cache;
+    // page numbers come from the file, page 0 is the header
+    if (page == 0 || page >= tree->header.page_count) {
+        printf("El árbol apunta a la página %u, fuera del archivo.\n", page);
+        exit(1);
+    }
+    int s = cache->slot_of_page[page];
+
+    if (s != -1) {
+        cache->hits++;
+        if (cache->head != s) {
+            lru_unlink(cache, s);
+            lru_push_front(cache, s);
+        }
+        return cache->frames + (size_t)s * PAGE_ENTRIES;
+    }
+
+    // miss: take a free slot or evict the least recently used page
+    cache->misses++;
+    if (cache->used < cache->capacity) {
+        s = cache->used++;
+    }
+    else {
+        s = cache->tail;
+        lru_unlink(cache, s);
+        cache->slot_of_page[cache->frame_page[s]] = -1;
+        cache->evictions++;
+    }
+
+    DiskEntry* frame = cache->frames + (size_t)s * PAGE_ENTRIES;
+    if (pread(tree->fd, frame, DISK_PAGE_SIZE, (off_t)page * DISK_PAGE_SIZE) != DISK_PAGE_SIZE) {
+        printf("Error leyendo la página %u del árbol.\n", page);
+        exit(1);
+    }
+    (*disk_accesses)++;
+
+    cache->frame_page[s] = page;
+    cache->slot_of_page[page] = s;
+    lru_push_front(cache, s);
+    return frame;
+}
+
+// Función que realiza la query Q en el nodo guardado en la página page (con num_entries entradas), guardando los puntos en sol
+void paged_range_search(PagedTree* tree, uint32_t page, int num_entries, Query Q, PointBuffer* sol, int* disk_accesses) {
+    Point q = Q.q;
+    double r = Q.r;
+    if (num_entries < 0 || num_entries > (int)PAGE_ENTRIES) {
+        printf("La página %u del árbol tiene %d entradas.\n", page, num_entries);
+        exit(1);
+    }
+    DiskEntry* entries = fetch_page(tree, page, disk_accesses);
+
+    // Children are copied out before descending, since visiting them may evict this page from the cache
+    uint32_t children[PAGE_ENTRIES];
+    int children_entries[PAGE_ENTRIES];
+    int num_children = 0;
+
+    for (int i = 0; i < num_entries; i++) {
+        DiskEntry e = entries[i];
+        if (e.child == 0) {
+            if (euclidean_distance(e.p, q) <= r)
+                push_point(sol, e.p);
+        }
+        else if (euclidean_distance(e.p, q) <= e.cr + r) {
+            children[num_children] = e.child;
+            children_entries[num_children] = e.child_entries;
+            num_children++;
+        }
+    }
+
+    for (int i = 0; i < num_children; i++)
+        paged_range_search(tree, children[i], children_entries[i], Q, sol, disk_accesses);
+}
+
+// Función que busca los puntos en la query Q del árbol paginado tree, guarda cuántos son en result_size y las lecturas de páginas en disk_accesses
+Point* paged_search_points_in_radio(PagedTree* tree, Query Q, int* result_size, int* disk_accesses) {
+    PointBuffer sol = {NULL, 0, 0};
+
+    paged_range_search(tree, tree->header.root_page, tree->header.root_entries, Q, &sol, disk_accesses);
+    *result_size = sol.size;
+    return sol.points;
+}
+
+#endif
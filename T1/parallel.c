@@ -0,0 +1,77 @@
+#ifndef PARALLEL_C
+#define PARALLEL_C
+
+#include <stdatomic.h>
+
+#include "mtree.c"
+#include "threadpool.c"
+
+// Cantidad de consultas que toma un hilo cada vez que pide trabajo
+#define QUERY_CHUNK 16
+
+typedef struct queryresult QueryResult;
+
+// Estructura que representa el resultado de una consulta ejecutada en paralelo
+struct queryresult {
+    Point* points;
+    int size;
+};
+
+// Estructura con el trabajo compartido por los hilos que ejecutan las consultas
+typedef struct {
+    Node* tree;
+    Query* Qs;
+    int num_queries;
+    QueryResult* results;
+    atomic_int next; // first query not taken yet
+    int* worker_accesses; // disk accesses counted by each worker
+} ParallelQueries;
+
+// Función que retorna el tiempo actual en segundos, para medir tiempos de ejecución
+double wall_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Función que ejecuta cada hilo: toma bloques de consultas hasta que no quedan y las resuelve con sus propios buffers y contador
+void parallel_queries_job(void* ctx, int worker) {
+    ParallelQueries* work = (ParallelQueries*)ctx;
+    int accesses = 0;
+
+    while (1) {
+        int first = atomic_fetch_add(&work->next, QUERY_CHUNK);
+        if (first >= work->num_queries)
+            break;
+        int last = intMin(first + QUERY_CHUNK, work->num_queries);
+
+        for (int j = first; j < last; j++) {
+            PointBuffer sol = {NULL, 0, 0};
+            range_search(work->tree, work->Qs[j], &sol, &accesses);
+            work->results[j].points = sol.points;
+            work->results[j].size = sol.size;
+        }
+    }
+
+    work->worker_accesses[worker] = accesses;
+}
+
+// Función que resuelve las num_queries consultas de Qs sobre tree con los hilos de pool, guardando el resultado de la consulta j
+// en results[j]. Los accesos a disco de todos los hilos se suman en disk_accesses
+void parallel_search_points_in_radio(ThreadPool* pool, Node* tree, Query* Qs, int num_queries, QueryResult* results, int* disk_accesses) {
+    ParallelQueries work;
+    work.tree = tree;
+    work.Qs = Qs;
+    work.num_queries = num_queries;
+    work.results = results;
+    atomic_init(&work.next, 0);
+    work.worker_accesses = (int*)calloc(pool->num_threads, sizeof(int));
+
+    thread_pool_run(pool, parallel_queries_job, &work);
+
+    for (int i = 0; i < pool->num_threads; i++)
+        *disk_accesses += work.worker_accesses[i];
+    free(work.worker_accesses);
+}
+
+#endif
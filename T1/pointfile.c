@@ -0,0 +1,174 @@
+#ifndef POINTFILE_C
+#define POINTFILE_C
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mtree.c"
+
+#define POINT_FILE_MAGIC "MTREEPT1"
+
+// Cantidad de puntos que lee cada pread de un archivo de puntos abierto sin mmap
+#define POINT_SOURCE_CHUNK 65536
+
+typedef struct pointfileheader PointFileHeader;
+typedef struct pointsource PointSource;
+
+// Estructura del comienzo de un archivo de puntos, seguido de count puntos guardados como Point
+struct pointfileheader {
+    char magic[8];
+    uint32_t point_size;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t seed; // seed given to generate_point_file
+};
+
+// Estructura que representa de dónde leen sus puntos los métodos de construcción: un arreglo en memoria,
+// un archivo de puntos abierto con mmap o un archivo que se lee por bloques con pread
+struct pointsource {
+    const Point* points; // every point, NULL when the file is read by chunks
+    int size;
+    int fd; // -1 for arrays
+    void* map;
+    size_t map_length;
+    Point* chunk; // last chunk read with pread
+};
+
+// Función que avanza el generador splitmix64 de estado state y retorna su siguiente número. A diferencia de rand,
+// da la misma secuencia en cualquier máquina
+uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Función que retorna un double aleatorio en [0, 1) a partir del generador de estado state
+double splitmix64_double(uint64_t* state) {
+    return (splitmix64(state) >> 11) * 0x1.0p-53;
+}
+
+// Función que guarda en P count puntos aleatorios en [0, 1)^2, avanzando el generador de estado state
+void generate_points(Point* P, int count, uint64_t* state) {
+    for (int i = 0; i < count; i++) {
+        P[i].x = splitmix64_double(state);
+        P[i].y = splitmix64_double(state);
+    }
+}
+
+// Función que escribe en path un archivo con count puntos aleatorios en [0, 1)^2 generados con la semilla seed.
+// El mismo seed da el mismo archivo en cualquier máquina. Retorna 0 si tuvo éxito y -1 si no
+int generate_point_file(const char* path, int count, uint64_t seed) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+
+    PointFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, POINT_FILE_MAGIC, sizeof(header.magic));
+    header.point_size = sizeof(Point);
+    header.count = count;
+    header.seed = seed;
+    int ok = write(fd, &header, sizeof(header)) == sizeof(header);
+
+    Point* chunk = (Point*)malloc(POINT_SOURCE_CHUNK * sizeof(Point));
+    uint64_t state = seed;
+    for (int first = 0; ok && first < count; first += POINT_SOURCE_CHUNK) {
+        int n = intMin(POINT_SOURCE_CHUNK, count - first);
+        generate_points(chunk, n, &state);
+        ok = write(fd, chunk, n * sizeof(Point)) == (ssize_t)(n * sizeof(Point));
+    }
+    free(chunk);
+
+    ok = fsync(fd) == 0 && ok;
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+// Función que retorna una fuente con los P_size puntos del arreglo P
+PointSource memory_point_source(Point* P, int P_size) {
+    PointSource source = {P, P_size, -1, NULL, 0, NULL};
+    return source;
+}
+
+// Función que abre el archivo de puntos path. Con use_mmap en 1 los puntos se leen del archivo mapeado en memoria,
+// y si no, por bloques de POINT_SOURCE_CHUNK puntos. Retorna NULL si el archivo no es un archivo de puntos
+PointSource* open_point_source(const char* path, int use_mmap) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    PointFileHeader header;
+    struct stat st;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+        memcmp(header.magic, POINT_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.point_size != sizeof(Point) || header.count > INT_MAX ||
+        fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(header) + header.count * sizeof(Point)) {
+        close(fd);
+        return NULL;
+    }
+
+    PointSource* source = (PointSource*)malloc(sizeof(PointSource));
+    *source = (PointSource){NULL, (int)header.count, fd, NULL, 0, NULL};
+
+    if (use_mmap) {
+        source->map_length = sizeof(header) + header.count * sizeof(Point);
+        source->map = mmap(NULL, source->map_length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (source->map == MAP_FAILED) {
+            close(fd);
+            free(source);
+            return NULL;
+        }
+        // the loaders read the points from start to end
+        madvise(source->map, source->map_length, MADV_SEQUENTIAL);
+        source->points = (const Point*)((char*)source->map + sizeof(header));
+    }
+    else {
+        source->chunk = (Point*)malloc(POINT_SOURCE_CHUNK * sizeof(Point));
+    }
+    return source;
+}
+
+// Función que cierra una fuente abierta con open_point_source
+void close_point_source(PointSource* source) {
+    if (source->map != NULL)
+        munmap(source->map, source->map_length);
+    free(source->chunk);
+    close(source->fd);
+    free(source);
+}
+
+// Función que retorna los puntos de source desde first, guardando en count cuántos son (al menos 1 si first < size).
+// Si los puntos se leen por bloques, el puntero es válido hasta la siguiente lectura de source
+const Point* point_source_chunk(PointSource* source, int first, int* count) {
+    if (source->points != NULL) {
+        *count = source->size - first;
+        return source->points + first;
+    }
+
+    *count = intMin(POINT_SOURCE_CHUNK, source->size - first);
+    size_t bytes = *count * sizeof(Point);
+    if (pread(source->fd, source->chunk, bytes, sizeof(PointFileHeader) + (off_t)first * sizeof(Point)) != (ssize_t)bytes) {
+        printf("Error leyendo los puntos desde el %i.\n", first);
+        exit(1);
+    }
+    return source->chunk;
+}
+
+// Función que retorna el punto i de source
+Point point_source_get(PointSource* source, int i) {
+    if (source->points != NULL)
+        return source->points[i];
+
+    Point p;
+    if (pread(source->fd, &p, sizeof(Point), sizeof(PointFileHeader) + (off_t)i * sizeof(Point)) != sizeof(Point)) {
+        printf("Error leyendo el punto %i.\n", i);
+        exit(1);
+    }
+    return p;
+}
+
+#endif
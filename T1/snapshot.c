@@ -0,0 +1,173 @@
+#ifndef SNAPSHOT_C
+#define SNAPSHOT_C
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pager.c"
+
+#define SNAPSHOT_MAGIC "MTREESN1"
+
+typedef struct snapshotheader SnapshotHeader;
+typedef struct snapshot Snapshot;
+
+// Estructura del comienzo del archivo. Le siguen entry_count entradas DiskEntry, donde las entradas de la raíz
+// son las primeras root_entries y el campo child de cada entrada es el índice de la primera entrada del hijo (0 si es hoja)
+struct snapshotheader {
+    char magic[8];
+    uint32_t entry_size;
+    uint32_t root_entries;
+    uint64_t entry_count;
+    uint64_t reserved;
+};
+
+_Static_assert(sizeof(SnapshotHeader) % sizeof(double) == 0, "Las entradas deben quedar alineadas después del encabezado");
+
+// Estructura que representa un snapshot abierto con mmap
+struct snapshot {
+    void* base;
+    size_t length;
+    SnapshotHeader* header;
+    DiskEntry* entries;
+};
+
+// Función que cuenta las entradas de todos los nodos del árbol node
+uint64_t count_entries(Node* node) {
+    uint64_t count = node->num_entries;
+    for (int i = 0; i < node->num_entries; i++) {
+        if (node->entries[i].a != NULL)
+            count += count_entries(node->entries[i].a);
+    }
+    return count;
+}
+
+// Función que copia las entradas de node a partir de entries[first], reservando espacio para sus hijos desde *next
+void flatten_node(Node* node, DiskEntry* entries, uint32_t first, uint32_t* next) {
+    // entries of the children of a node are stored one after the other
+    for (int i = 0; i < node->num_entries; i++) {
+        Entry e = node->entries[i];
+        DiskEntry* d = &entries[first + i];
+        d->p = e.p;
+        d->cr = e.cr;
+        d->child = 0;
+        d->child_entries = 0;
+        if (e.a != NULL) {
+            d->child = *next;
+            d->child_entries = e.a->num_entries;
+            *next += e.a->num_entries;
+        }
+    }
+
+    for (int i = 0; i < node->num_entries; i++) {
+        DiskEntry d = entries[first + i];
+        if (d.child != 0)
+            flatten_node(node->entries[i].a, entries, d.child, next);
+    }
+}
+
+// Función que guarda el árbol root en el archivo path sin punteros. Retorna 0 si tuvo éxito y -1 si no
+int write_snapshot(Node* root, const char* path) {
+    uint64_t entry_count = count_entries(root);
+    if (entry_count > UINT32_MAX)
+        return -1;
+
+    DiskEntry* entries = (DiskEntry*)calloc(entry_count, sizeof(DiskEntry));
+    uint32_t next = root->num_entries;
+    flatten_node(root, entries, 0, &next);
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.entry_size = sizeof(DiskEntry);
+    header.root_entries = root->num_entries;
+    header.entry_count = entry_count;
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        free(entries);
+        return -1;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(entries, sizeof(DiskEntry), entry_count, file) == entry_count;
+    ok = fclose(file) == 0 && ok;
+    free(entries);
+    return ok ? 0 : -1;
+}
+
+// Función que abre un snapshot con una sola llamada a mmap, sin deserializar los nodos. Retorna NULL si el encabezado no es válido;
+// los hijos de cada entrada se revisan al visitarla en snapshot_range_search
+Snapshot* open_snapshot(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    SnapshotHeader* header = (SnapshotHeader*)base;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->entry_size != sizeof(DiskEntry) ||
+        sizeof(SnapshotHeader) + header->entry_count * sizeof(DiskEntry) != (uint64_t)st.st_size ||
+        header->root_entries > header->entry_count) {
+        munmap(base, st.st_size);
+        return NULL;
+    }
+
+    Snapshot* snapshot = (Snapshot*)malloc(sizeof(Snapshot));
+    snapshot->base = base;
+    snapshot->length = st.st_size;
+    snapshot->header = header;
+    snapshot->entries = (DiskEntry*)((char*)base + sizeof(SnapshotHeader));
+    return snapshot;
+}
+
+// Función que libera el mapeo del snapshot
+void close_snapshot(Snapshot* snapshot) {
+    munmap(snapshot->base, snapshot->length);
+    free(snapshot);
+}
+
+// Función que realiza la query Q en el nodo cuyas num_entries entradas parten en first, directamente sobre el mapeo.
+// Termina el programa con un error si una entrada visitada tiene hijos fuera del archivo
+void snapshot_range_search(Snapshot* snapshot, uint32_t first, int num_entries, Query Q, PointBuffer* sol, int* disk_accesses) {
+    Point q = Q.q;
+    double r = Q.r;
+    DiskEntry* entries = snapshot->entries + first;
+
+    (*disk_accesses)++;
+    for (int i = 0; i < num_entries; i++) {
+        DiskEntry e = entries[i];
+        if (e.child == 0) {
+            if (euclidean_distance(e.p, q) <= r)
+                push_point(sol, e.p);
+        }
+        else if (euclidean_distance(e.p, q) <= e.cr + r) {
+            // children are always stored after their entry, so a valid walk only moves forward and cannot loop or leave the file
+            if (e.child <= first + (uint64_t)i || e.child_entries < 0 ||
+                e.child + (uint64_t)e.child_entries > snapshot->header->entry_count) {
+                printf("La entrada %lu del snapshot tiene hijos fuera del archivo.\n", (unsigned long)(first + (uint64_t)i));
+                exit(1);
+            }
+            snapshot_range_search(snapshot, e.child, e.child_entries, Q, sol, disk_accesses);
+        }
+    }
+}
+
+// Función que busca los puntos en la query Q del snapshot, guarda cuántos son en result_size y los accesos a disco en la dirección disk_accesses
+Point* snapshot_search_points_in_radio(Snapshot* snapshot, Query Q, int* result_size, int* disk_accesses) {
+    PointBuffer sol = {NULL, 0, 0};
+
+    snapshot_range_search(snapshot, 0, snapshot->header->root_entries, Q, &sol, disk_accesses);
+    *result_size = sol.size;
+    return sol.points;
+}
+
+#endif
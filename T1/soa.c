@@ -0,0 +1,214 @@
+#ifndef SOA_C
+#define SOA_C
+
+#include "mtree.c"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SOA_X86 1
+#endif
+
+// Cantidad de entradas que compara cada instrucción AVX2 (4 doubles por registro de 256 bits)
+#define SOA_LANES 4
+
+typedef struct soanode SoaNode;
+typedef struct soatree SoaTree;
+
+// Estructura que representa un nodo con sus entradas separadas por campo (structure of arrays), para que recorrer
+// una hoja solo lea coordenadas. Los arreglos tienen padded elementos; los que sobran tienen coordenadas infinitas
+// y nunca cumplen una consulta. Las hojas no guardan cr ni child
+struct soanode {
+    int num_entries;
+    int padded; // num_entries rounded up to SOA_LANES
+    int leaf;
+    double* xs;
+    double* ys;
+    double* cr;
+    SoaNode** child; // NULL for the entries that are points
+};
+
+// Estructura que representa un árbol con nodos SoaNode, guardados en un arena que se libera de una vez
+struct soatree {
+    Arena* arena;
+    SoaNode* root;
+};
+
+// Funciones que guardan en hits los índices de las entradas que cumplen la consulta y retornan cuántas son.
+// Las de hojas comparan d(q, p)^2 <= r2 y las de nodos internos d(q, p) <= cr + r, sin elevar al cuadrado como range_search_from
+typedef int (*LeafScan)(const double* xs, const double* ys, int padded, double qx, double qy, double r2, int* hits);
+typedef int (*InternalScan)(const double* xs, const double* ys, const double* cr, int padded, double qx, double qy, double r, int* hits);
+
+// Función que recorre una hoja comparando una entrada a la vez
+int leaf_scan_scalar(const double* xs, const double* ys, int padded, double qx, double qy, double r2, int* hits) {
+    int count = 0;
+    for (int i = 0; i < padded; i++) {
+        double dx = xs[i] - qx;
+        double dy = ys[i] - qy;
+        if (dx * dx + dy * dy <= r2)
+            hits[count++] = i;
+    }
+    return count;
+}
+
+// Función que recorre un nodo interno comparando una entrada a la vez
+int internal_scan_scalar(const double* xs, const double* ys, const double* cr, int padded, double qx, double qy, double r, int* hits) {
+    int count = 0;
+    for (int i = 0; i < padded; i++) {
+        double dx = xs[i] - qx;
+        double dy = ys[i] - qy;
+        if (sqrt(dx * dx + dy * dy) <= cr[i] + r)
+            hits[count++] = i;
+    }
+    return count;
+}
+
+#ifdef SOA_X86
+// Función que recorre una hoja comparando SOA_LANES entradas por instrucción con AVX2
+__attribute__((target("avx2")))
+int leaf_scan_avx2(const double* xs, const double* ys, int padded, double qx, double qy, double r2, int* hits) {
+    __m256d vqx = _mm256_set1_pd(qx);
+    __m256d vqy = _mm256_set1_pd(qy);
+    __m256d vr2 = _mm256_set1_pd(r2);
+    int count = 0;
+    for (int i = 0; i < padded; i += SOA_LANES) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), vqx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), vqy);
+        __m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(d2, vr2, _CMP_LE_OQ));
+        // one bit per entry inside the query
+        while (mask != 0) {
+            hits[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    return count;
+}
+
+// Función que recorre un nodo interno comparando SOA_LANES entradas por instrucción con AVX2
+__attribute__((target("avx2")))
+int internal_scan_avx2(const double* xs, const double* ys, const double* cr, int padded, double qx, double qy, double r, int* hits) {
+    __m256d vqx = _mm256_set1_pd(qx);
+    __m256d vqy = _mm256_set1_pd(qy);
+    __m256d vr = _mm256_set1_pd(r);
+    int count = 0;
+    for (int i = 0; i < padded; i += SOA_LANES) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), vqx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), vqy);
+        __m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        __m256d reach = _mm256_add_pd(_mm256_loadu_pd(cr + i), vr);
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_sqrt_pd(d2), reach, _CMP_LE_OQ));
+        while (mask != 0) {
+            hits[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    return count;
+}
+#endif
+
+// Recorridos usados por soa_range_search, elegidos por select_soa_scans según la CPU
+LeafScan leaf_scan = leaf_scan_scalar;
+InternalScan internal_scan = internal_scan_scalar;
+
+// Función que usa los recorridos AVX2 si la CPU los soporta. Compilando con -DSOA_SCALAR se usan siempre los escalares
+void select_soa_scans() {
+#if defined(SOA_X86) && !defined(SOA_SCALAR)
+    if (__builtin_cpu_supports("avx2")) {
+        leaf_scan = leaf_scan_avx2;
+        internal_scan = internal_scan_avx2;
+    }
+#endif
+}
+
+// Función que copia el nodo node y sus descendientes al arena, con las entradas separadas por campo
+SoaNode* soa_copy_node(Arena* arena, Node* node) {
+    int n = node->num_entries;
+    int padded = (n + SOA_LANES - 1) / SOA_LANES * SOA_LANES;
+    int leaf = 1;
+    for (int i = 0; i < n; i++) {
+        if (node->entries[i].a != NULL)
+            leaf = 0;
+    }
+
+    // the node and its arrays are stored together
+    int arrays = leaf ? 2 : 3;
+    size_t size = sizeof(SoaNode) + arrays * padded * sizeof(double) + (leaf ? 0 : padded * sizeof(SoaNode*));
+    SoaNode* soa = (SoaNode*)arena_alloc(arena, size);
+    soa->num_entries = n;
+    soa->padded = padded;
+    soa->leaf = leaf;
+    soa->xs = (double*)(soa + 1);
+    soa->ys = soa->xs + padded;
+    soa->cr = leaf ? NULL : soa->ys + padded;
+    soa->child = leaf ? NULL : (SoaNode**)(soa->cr + padded);
+
+    for (int i = 0; i < padded; i++) {
+        soa->xs[i] = i < n ? node->entries[i].p.x : INFINITY;
+        soa->ys[i] = i < n ? node->entries[i].p.y : INFINITY;
+        if (!leaf) {
+            soa->cr[i] = i < n ? node->entries[i].cr : 0.0;
+            soa->child[i] = NULL;
+        }
+    }
+
+    if (!leaf) {
+        for (int i = 0; i < n; i++) {
+            if (node->entries[i].a != NULL)
+                soa->child[i] = soa_copy_node(arena, node->entries[i].a);
+        }
+    }
+    return soa;
+}
+
+// Función que crea una copia del árbol root con nodos SoaNode, para consultarlo con soa_search_points_in_radio
+SoaTree* create_soa_tree(Node* root) {
+    select_soa_scans();
+    SoaTree* tree = (SoaTree*)malloc(sizeof(SoaTree));
+    tree->arena = create_arena(ARENA_BLOCK_SIZE, 0);
+    tree->root = soa_copy_node(tree->arena, root);
+    return tree;
+}
+
+// Función que libera todos los nodos del árbol
+void destroy_soa_tree(SoaTree* tree) {
+    destroy_arena(tree->arena);
+    free(tree);
+}
+
+// Función que realiza la query Q en el nodo node, guardando los puntos en sol y los accesos a disco en disk_accesses
+void soa_range_search(SoaNode* node, Query Q, PointBuffer* sol, int* disk_accesses) {
+    int hits[node->padded + 1];
+
+    (*disk_accesses)++;
+    if (node->leaf) {
+        int count = leaf_scan(node->xs, node->ys, node->padded, Q.q.x, Q.q.y, Q.r * Q.r, hits);
+        for (int k = 0; k < count; k++) {
+            Point p = {node->xs[hits[k]], node->ys[hits[k]]};
+            push_point(sol, p);
+        }
+    }
+    else {
+        int count = internal_scan(node->xs, node->ys, node->cr, node->padded, Q.q.x, Q.q.y, Q.r, hits);
+        for (int k = 0; k < count; k++) {
+            int i = hits[k];
+            // entries without a child are points, and their cr is 0
+            if (node->child[i] != NULL) {
+                soa_range_search(node->child[i], Q, sol, disk_accesses);
+            }
+            else {
+                Point p = {node->xs[i], node->ys[i]};
+                push_point(sol, p);
+            }
+        }
+    }
+}
+
+// Función que busca los puntos en la query Q del árbol tree, guarda cuántos son en result_size y los accesos a disco en disk_accesses
+Point* soa_search_points_in_radio(SoaTree* tree, Query Q, int* result_size, int* disk_accesses) {
+    PointBuffer sol = {NULL, 0, 0};
+
+    soa_range_search(tree->root, Q, &sol, disk_accesses);
+    *result_size = sol.size;
+    return sol.points;
+}
+
+#endif
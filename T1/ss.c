@@ -3,6 +3,9 @@
 typedef struct {
     Point *points;
     int size;
+    Point medoid; // cached primary medoid, valid when ecc is not NULL
+    double radius; // max distance from the medoid to the points of the cluster
+    double *ecc; // max distance from each point to the others
 } Cluster;
 
 typedef struct {
@@ -20,40 +23,71 @@ typedef struct {
     int size;
 } EntryArrayArray;
 
-// Función que encuentra el medoide primario en un cluster
-Point primary_medoid(Cluster *cluster) {
-    double min_radius = 0.0;
-    Point primary_medoid = cluster->points[0];
-    for (int i = 0; i < cluster->size; i++) {
-        double max_distance = 0.0;
-
-        // Calculate the maximum distance to other points in the cluster
-        for (int j = 0; j < cluster->size; j++) {
-            if (i == j) {
-                continue; // Skip comparing a point to itself
-            }
-            double dist = euclidean_distance(cluster->points[i], cluster->points[j]);
-            if (dist > max_distance) {
-                max_distance = dist;
-            }
-        } 
+// Función que encuentra el máximo entre dos doubles
+double max(double i, double j) {
+    return (i > j) ? i : j;
+}
 
-        // Update the minimum radius and primary medoid if needed
-        if (max_distance < min_radius || i == 0) {
-            min_radius = max_distance;
-            primary_medoid = cluster->points[i];
+// Función que encuentra el mínimo entre dos doubles
+double min(double i, double j) {
+    return i < j ? i : j;
+}
+
+// Función que elige como medoide el punto de menor excentricidad del cluster, que ya tiene ecc calculado
+void select_medoid(Cluster *cluster) {
+    cluster->medoid = cluster->points[0];
+    cluster->radius = cluster->ecc[0];
+    for (int i = 1; i < cluster->size; i++) {
+        if (cluster->ecc[i] < cluster->radius) {
+            cluster->radius = cluster->ecc[i];
+            cluster->medoid = cluster->points[i];
         }
     }
+}
 
-    return primary_medoid;
+// Función que calcula desde cero la excentricidad de cada punto, el medoide primario y el radio de un cluster
+void compute_cluster_cache(Cluster *cluster) {
+    int n = cluster->size;
+    free(cluster->ecc);
+    cluster->ecc = (double *)calloc(n, sizeof(double));
+    double *distances = (double *)malloc(n * sizeof(double));
+    for (int i = 0; i < n; i++) {
+        // Calculate the maximum squared distance to other points in the cluster, each pair once
+        int later = n - i - 1;
+        squared_distances(&cluster->points[i].x, &cluster->points[i].x + POINT_STRIDE, POINT_STRIDE, later, distances);
+        for (int k = 0; k < later; k++) {
+            cluster->ecc[i] = max(cluster->ecc[i], distances[k]);
+            cluster->ecc[i + 1 + k] = max(cluster->ecc[i + 1 + k], distances[k]);
+        }
+    }
+    // sqrt keeps the order, so the root of the largest squared distance is the largest distance
+    for (int i = 0; i < n; i++) {
+        cluster->ecc[i] = sqrt(cluster->ecc[i]);
+    }
+    free(distances);
+    select_medoid(cluster);
 }
 
-// Función que calcula distancia entre dos clusters
+// Función que retorna el medoide primario de un cluster, calculándolo solo si no está guardado
+Point primary_medoid(Cluster *cluster) {
+    if (cluster->ecc == NULL) {
+        compute_cluster_cache(cluster);
+    }
+    return cluster->medoid;
+}
+
+// Función que libera los puntos y el cache de un cluster
+void free_cluster(Cluster *cluster) {
+    free(cluster->points);
+    free(cluster->ecc);
+    cluster->points = NULL;
+    cluster->ecc = NULL;
+    cluster->size = 0;
+}
+
+// Función que calcula distancia entre dos clusters usando sus medoides guardados
 double clusterDist(Cluster c1, Cluster c2) {
-    Point pm_c1 = primary_medoid(&c1);
-    Point pm_c2 = primary_medoid(&c2);
-    double dist = euclidean_distance(pm_c1, pm_c2);
-    return dist;
+    return euclidean_distance(c1.medoid, c2.medoid);
 }
 
 // Función que devuelve el vecino más cercano de un cluster en clustersSet
@@ -79,11 +113,12 @@ int closest_neighbor(Cluster cluster, ClusterArray clustersSet) {
     return closest_neighbor;
 }
 
-// Función que une dos clusters
+// Función que une dos clusters, actualizando el medoide y radio guardados a partir de los de c1 y c2
 Cluster merge_clusters(Cluster c1, Cluster c2) {
     Cluster merged_cluster;
     merged_cluster.size = c1.size + c2.size;
     merged_cluster.points = (Point*)malloc(merged_cluster.size * sizeof(Point));
+    merged_cluster.ecc = NULL;
     
     // Copy points from c1 and c2 into merged_cluster
     int index = 0;
@@ -94,136 +129,310 @@ Cluster merge_clusters(Cluster c1, Cluster c2) {
         merged_cluster.points[index++] = c2.points[i];
     }
 
+    // without the eccentricities of both clusters there is nothing to update
+    if ((c1.size > 0 && c1.ecc == NULL) || (c2.size > 0 && c2.ecc == NULL)) {
+        compute_cluster_cache(&merged_cluster);
+        return merged_cluster;
+    }
+
+    double *ecc1 = (double *)malloc(merged_cluster.size * sizeof(double));
+    double *ecc2 = ecc1 + c1.size;
+    for (int i = 0; i < c1.size; i++) {
+        ecc1[i] = c1.ecc[i];
+    }
+    for (int j = 0; j < c2.size; j++) {
+        ecc2[j] = c2.ecc[j];
+    }
+
+    // the eccentricity of a point grows with its distances to the points of the other cluster,
+    // the largest ones are found with squared distances and only those get a sqrt
+    double *distances = (double *)malloc(c2.size * sizeof(double));
+    double *farthest2 = (double *)calloc(c2.size, sizeof(double));
+    for (int i = 0; i < c1.size; i++) {
+        squared_distances(&c1.points[i].x, &c2.points[0].x, POINT_STRIDE, c2.size, distances);
+        double farthest1 = 0.0;
+        for (int j = 0; j < c2.size; j++) {
+            farthest1 = max(farthest1, distances[j]);
+            farthest2[j] = max(farthest2[j], distances[j]);
+        }
+        ecc1[i] = max(ecc1[i], sqrt(farthest1));
+    }
+    for (int j = 0; j < c2.size; j++) {
+        ecc2[j] = max(ecc2[j], sqrt(farthest2[j]));
+    }
+    free(distances);
+    free(farthest2);
+
+    merged_cluster.ecc = ecc1;
+    select_medoid(&merged_cluster);
     return merged_cluster;
 }
 
-// Función que encuentra el par más cercano en un set de clusters, retorna arreglo con los dos clusters
-int* closest_pair(ClusterArray* clustersSet) {
+// Cantidad mínima de puntos de un cluster para evaluar sus pares en paralelo en MinMaxSplitPolicy
+#define SPLIT_PARALLEL_MIN 64
+
+// Hilos con los que MinMaxSplitPolicy evalúa los pares de puntos, NULL para evaluarlos en el hilo actual
+ThreadPool *split_pool = NULL;
+
+// Estructura que representa un punto del cluster y el cuadrado de su distancia a otro punto. Los radios se comparan
+// al cuadrado, lo que no cambia el par elegido
+typedef struct {
+    double dist;
+    int index;
+} SplitNeighbor;
+
+// Estructura con el trabajo de MinMaxSplitPolicy compartido por los hilos
+typedef struct {
+    Point *points;
+    int n;
+    SplitNeighbor *rows; // row i: every point sorted by distance to point i
+    SplitNeighbor *order; // points sorted by the lower bound of the radius of any pair that uses them
+    char *assigned; // one scratch array of n flags per thread
+    double *distances; // one scratch array of n squared distances per thread
+    atomic_int next_row;
+    double *best_radius; // best pair found by each thread
+    int *best_i;
+    int *best_j;
+} SplitJob;
+
+// Buffers de MinMaxSplitPolicy, que se reutilizan entre llamadas en vez de pedir memoria por cada par
+SplitNeighbor *split_rows = NULL;
+SplitNeighbor *split_order = NULL;
+char *split_assigned = NULL;
+double *split_distances = NULL;
+int split_rows_capacity = 0;
+int split_order_capacity = 0;
+int split_assigned_capacity = 0;
+int split_distances_capacity = 0;
+
+// Función que ordena dos vecinos por distancia y luego por índice
+int compare_split_neighbors(const void *a, const void *b2) {
+    const SplitNeighbor *x = (const SplitNeighbor *)a;
+    const SplitNeighbor *y = (const SplitNeighbor *)b2;
+    if (x->dist != y->dist) {
+        return x->dist < y->dist ? -1 : 1;
+    }
+    return x->index - y->index;
+}
+
+// Función que reparte alternadamente los puntos del cluster entre los centros i y j, cada uno tomando el punto libre más
+// cercano a él. Retorna el radio cobertor máximo, o un valor > bound apenas se sabe que lo supera.
+// Si c1 y c2 no son NULL guarda en ellos la partición
+double alternate_split(SplitJob *job, char *assigned, int i, int j, double bound, Cluster *c1, Cluster *c2) {
+    int n = job->n;
+    SplitNeighbor *row_i = job->rows + (size_t)i * n;
+    SplitNeighbor *row_j = job->rows + (size_t)j * n;
+    int next_i = 0, next_j = 0;
+    int left_i = (n - 1) / 2, left_j = (n - 2) / 2; // points each center still has to take
+    double r1 = 0.0, r2 = 0.0;
+
+    memset(assigned, 0, n);
+    assigned[i] = 1;
+    assigned[j] = 1;
+    if (c1 != NULL) {
+        c1->points[c1->size++] = job->points[i];
+        c2->points[c2->size++] = job->points[j];
+    }
+
+    for (int taken = 2; taken < n; taken++) {
+        // rows are sorted, so the radius of each center is the distance to the last point it took
+        if (taken % 2 == 0) {
+            while (assigned[row_i[next_i].index]) {
+                next_i++;
+            }
+            assigned[row_i[next_i].index] = 1;
+            r1 = row_i[next_i].dist;
+            left_i--;
+            if (c1 != NULL) {
+                c1->points[c1->size++] = job->points[row_i[next_i].index];
+            }
+        }
+        else {
+            while (assigned[row_j[next_j].index]) {
+                next_j++;
+            }
+            assigned[row_j[next_j].index] = 1;
+            r2 = row_j[next_j].dist;
+            left_j--;
+            if (c1 != NULL) {
+                c2->points[c2->size++] = job->points[row_j[next_j].index];
+            }
+        }
+        // every point before the last one taken is assigned, so a center that still has to take k points
+        // ends with a radius of at least the distance k positions further in its row
+        double final_r1 = left_i > 0 ? row_i[next_i + left_i].dist : r1;
+        double final_r2 = left_j > 0 ? row_j[next_j + left_j].dist : r2;
+        if (max(final_r1, final_r2) > bound) {
+            return max(final_r1, final_r2);
+        }
+    }
+    return max(r1, r2);
+}
 
-    int* closest_pair = (int*)malloc(2 * sizeof(int));
-    double min_dist = __DBL_MAX__;
+// Función que ejecuta cada hilo: ordena las filas de distancias que le tocan
+void split_sort_rows_job(void *ctx, int worker) {
+    SplitJob *job = (SplitJob *)ctx;
+    int n = job->n;
+    int i;
+    while ((i = atomic_fetch_add(&job->next_row, 1)) < n) {
+        SplitNeighbor *row = job->rows + (size_t)i * n;
+        double *distances = job->distances + (size_t)worker * n;
+        squared_distances(&job->points[i].x, &job->points[0].x, POINT_STRIDE, n, distances);
+        for (int k = 0; k < n; k++) {
+            row[k].dist = distances[k];
+            row[k].index = k;
+        }
+        qsort(row, n, sizeof(SplitNeighbor), compare_split_neighbors);
+    }
+}
 
-    for (int i = 0; i < clustersSet->size; i++) {
-        for (int j = 0; j < clustersSet->size; j++) {
-            if (i == j) {
+// Función que ejecuta cada hilo: toma los puntos en orden de cota inferior y evalúa sus pares con los puntos anteriores,
+// descartando un par apenas su radio supera al mejor que conoce el hilo. Los empates se evalúan completos y se
+// desempatan por (i, j), para que gane siempre el mismo par
+void split_pairs_job(void *ctx, int worker) {
+    SplitJob *job = (SplitJob *)ctx;
+    char *assigned = job->assigned + (size_t)worker * job->n;
+    double best = __DBL_MAX__;
+    int best_i = -1, best_j = -1;
+    int n = job->n;
+    int a;
+    while ((a = atomic_fetch_add(&job->next_row, 1)) < n) {
+        // the pairs of every later point have a larger bound
+        if (job->order[a].dist > best) {
+            break;
+        }
+        for (int k = 0; k < a; k++) {
+            int i = intMin(job->order[a].index, job->order[k].index);
+            int j = job->order[a].index + job->order[k].index - i;
+
+            // center i takes (n - 1) / 2 other points and center j (n - 2) / 2, so each radius is at least the
+            // distance to that many-th nearest point (position 0 of a row is the center itself)
+            double lower_bound = max(job->rows[(size_t)i * n + (n - 1) / 2].dist, job->rows[(size_t)j * n + (n - 2) / 2].dist);
+            if (lower_bound > best) {
                 continue;
             }
-            double dist = clusterDist(clustersSet->clusters[i], clustersSet->clusters[j]);
-            if (dist < min_dist && dist != 0) {
-                min_dist = dist;
-                closest_pair[0] = i;
-                closest_pair[1] = j;
+            double radius = alternate_split(job, assigned, i, j, best, NULL, NULL);
+            if (radius < best || (radius == best && (i < best_i || (i == best_i && j < best_j)))) {
+                best = radius;
+                best_i = i;
+                best_j = j;
             }
         }
     }
-    return closest_pair;
+    job->best_radius[worker] = best;
+    job->best_i[worker] = best_i;
+    job->best_j[worker] = best_j;
 }
 
-// Función que realiza min max split policy de un cluster, devuelve arreglo con los 2 clusters obtenidos
+// Función que realiza min max split policy de un cluster, devuelve arreglo con los 2 clusters obtenidos.
+// Para cada par de puntos (i, j) los demás puntos se reparten alternadamente al centro i y al centro j, cada uno tomando
+// el punto libre más cercano, y se elige el par con menor radio cobertor máximo. Las dos mitades tienen a lo más
+// ceil(n / 2) puntos. Los pares se evalúan con las distancias ordenadas una sola vez y solo se construye la partición elegida
 ClusterArray MinMaxSplitPolicy(Cluster cluster) {
-
+    int n = cluster.size;
     ClusterArray divided_clusters;
     divided_clusters.size = 2;
     divided_clusters.clusters = (Cluster*)malloc(2 * sizeof(Cluster));
-    Cluster c1;
-    Cluster c2;
-    double min_max_radius = __DBL_MAX__;
-
-    for (int i = 0; i < cluster.size; i++) {
-        for (int j = i + 1; j < cluster.size; j++) {
-            // if (i == j) {
-            //    continue;
-            // }
-            // Initialize clusters c1 and c2
-            c1.size = 0;
-            c1.points = (Point*)malloc(cluster.size * sizeof(Point));
-            c2.size = 0;
-            c2.points = (Point*)malloc(cluster.size * sizeof(Point));
-
-            for (int k = 0; k < cluster.size; k++) {
-                if (k == i || k==j) {
-                    continue;
-                }
-                
-                double i_dist = euclidean_distance(cluster.points[i], cluster.points[k]);
-                double j_dist = euclidean_distance(cluster.points[j], cluster.points[k]);
-
-                if (i_dist < j_dist) {
-                    c1.size++;
-                    Point *added_c1 = (Point *)realloc(c1.points, c1.size * sizeof(Point));
-                    c1.points = added_c1;
-                    c1.points[c1.size - 1] = cluster.points[k];
-                } else if (i_dist > j_dist) {
-                    c2.size++;
-                    Point *added_c2 = (Point *)realloc(c2.points, c2.size * sizeof(Point));
-                    c2.points = added_c2;
-                    c2.points[c2.size - 1] = cluster.points[k];
-                }
 
-            }
+    Cluster c1 = {(Point*)malloc(((n + 1) / 2) * sizeof(Point)), 0, {0.0, 0.0}, 0.0, NULL};
+    Cluster c2 = {(Point*)malloc((n / 2 + 1) * sizeof(Point)), 0, {0.0, 0.0}, 0.0, NULL};
+    if (n < 2) {
+        for (int k = 0; k < n; k++) {
+            c1.points[c1.size++] = cluster.points[k];
+        }
+        divided_clusters.clusters[0] = c1;
+        divided_clusters.clusters[1] = c2;
+        return divided_clusters;
+    }
 
-            double max_covering_radius = 0.0;
+    ThreadPool *pool = (split_pool != NULL && n >= SPLIT_PARALLEL_MIN) ? split_pool : NULL;
+    int threads = pool != NULL ? pool->num_threads : 1;
 
-            for (int n = 0; n < c1.size; n++) {
-                if (n == i || n == j || n >= c1.size) {
-                    continue;
-                }
-                if (euclidean_distance(c1.points[n], cluster.points[i]) > max_covering_radius) {
-                    max_covering_radius = euclidean_distance(c1.points[n], cluster.points[i]);
-                }
-            }
-            for (int m = 0; m < c2.size; m++) {
-                if (m == i || m == j || m >= c2.size) {
-                    continue;
-                    }
-                if (euclidean_distance(c2.points[m], cluster.points[i]) > max_covering_radius) {
-                    max_covering_radius = euclidean_distance(c2.points[m], cluster.points[i]);
-                }
-            }
+    if (n * n > split_rows_capacity) {
+        split_rows_capacity = n * n;
+        split_rows = (SplitNeighbor*)realloc(split_rows, split_rows_capacity * sizeof(SplitNeighbor));
+    }
+    if (n > split_order_capacity) {
+        split_order_capacity = n;
+        split_order = (SplitNeighbor*)realloc(split_order, split_order_capacity * sizeof(SplitNeighbor));
+    }
+    if (threads * n > split_assigned_capacity) {
+        split_assigned_capacity = threads * n;
+        split_assigned = (char*)realloc(split_assigned, split_assigned_capacity);
+    }
+    if (threads * n > split_distances_capacity) {
+        split_distances_capacity = threads * n;
+        split_distances = (double*)realloc(split_distances, split_distances_capacity * sizeof(double));
+    }
 
-            if (max_covering_radius < min_max_radius) {
-                min_max_radius = max_covering_radius;
-                divided_clusters.clusters[0] = c1;
-                divided_clusters.clusters[1] = c2;
-            } else {
-                // Reinitialize clusters c1 and c2
-                c1.size = 0;
-                Point *new_c1 = (Point*)realloc(c1.points, cluster.size * sizeof(Point));
-                c1.points = new_c1;
-                c2.size = 0;
-                Point *new_c2 = (Point*)realloc(c2.points, cluster.size * sizeof(Point));
-                c2.points = new_c2;
-            }
+    double best_radius[threads];
+    int best_i[threads];
+    int best_j[threads];
+    SplitJob job;
+    job.points = cluster.points;
+    job.n = n;
+    job.rows = split_rows;
+    job.order = split_order;
+    job.assigned = split_assigned;
+    job.distances = split_distances;
+    job.best_radius = best_radius;
+    job.best_i = best_i;
+    job.best_j = best_j;
+
+    atomic_init(&job.next_row, 0);
+    if (pool != NULL) {
+        thread_pool_run(pool, split_sort_rows_job, &job);
+    }
+    else {
+        split_sort_rows_job(&job, 0);
+    }
+
+    // any center takes at least (n - 2) / 2 other points
+    for (int k = 0; k < n; k++) {
+        split_order[k].dist = split_rows[(size_t)k * n + (n - 2) / 2].dist;
+        split_order[k].index = k;
+    }
+    qsort(split_order, n, sizeof(SplitNeighbor), compare_split_neighbors);
+
+    atomic_store(&job.next_row, 0);
+    if (pool != NULL) {
+        thread_pool_run(pool, split_pairs_job, &job);
+    }
+    else {
+        split_pairs_job(&job, 0);
+    }
+
+    // the same pair wins whatever the number of threads: smallest radius, then smallest (i, j)
+    int winner = -1;
+    for (int t = 0; t < threads; t++) {
+        if (best_i[t] == -1) {
+            continue;
+        }
+        if (winner == -1 || best_radius[t] < best_radius[winner] ||
+            (best_radius[t] == best_radius[winner] && (best_i[t] < best_i[winner] || (best_i[t] == best_i[winner] && best_j[t] < best_j[winner])))) {
+            winner = t;
         }
     }
-    free(c1.points);
-    free(c2.points);
 
+    alternate_split(&job, split_assigned, best_i[winner], best_j[winner], __DBL_MAX__, &c1, &c2);
+    divided_clusters.clusters[0] = c1;
+    divided_clusters.clusters[1] = c2;
     return divided_clusters;
 }
 
-// Función que encuentra el máximo entre dos doubles
-double max(double i, double j) {
-    return (i > j) ? i : j;
-}
-
-// Función que encuentra el mínimo entre dos doubles
-double min(double i, double j) {
-    return i < j ? i : j;
+// Función que determina si un arreglo de tamaño size está lleno. Los arreglos crecen duplicando su capacidad,
+// así que la capacidad es la menor potencia de 2 mayor o igual a size y el arreglo se llena cuando size es 0 o potencia de 2
+int isFullArray(int size) {
+    return (size & (size - 1)) == 0;
 }
 
 // Función que añade un Cluster a un ClusterArray
 void addCluster(ClusterArray* C, Cluster* c) {
-    if (C->size == 0) {
-        C->clusters = (Cluster *)malloc(sizeof(Cluster));
-        C->clusters[C->size] = *c;
-        C->size++;
-    }
-    else {
-        C->clusters = (Cluster *)realloc(C->clusters, (C->size + 1) * sizeof(Cluster));
-        C->clusters[C->size] = *c;
-        C->size++;
+    if (isFullArray(C->size)) {
+        C->clusters = (Cluster *)realloc(C->clusters, (C->size == 0 ? 1 : 2 * C->size) * sizeof(Cluster));
     }
+    C->clusters[C->size] = *c;
+    C->size++;
 }
 
 // Función que elimina un cluster de un arreglo de clusters
@@ -232,64 +441,27 @@ void removeCluster(ClusterArray* C, int pos) {
     for (int i = pos; i < C->size-1; i++) {
         C->clusters[i] = C->clusters[i+1];
     }
-    /* redimensionamos el arreglo */
-    C->clusters = realloc(C->clusters, (C->size - 1) * sizeof(Cluster));
-    /* actualizamos el tamaño */
+    /* actualizamos el tamaño, el arreglo conserva su capacidad */
     C->size--;
 }
 
-// Función que añade una entrada a un nodo
-void addEntryInNode(Node* N, Entry* e) {   
-    if (N->num_entries == 0) {
-        N->entries = (Entry *)malloc(sizeof(Entry));
-        N->entries[N->num_entries] = *e;
-        N->num_entries++;
-    }
-    else {
-        N->entries = (Entry *)realloc(N->entries, (N->num_entries + 1) * sizeof(Entry));
-        N->entries[N->num_entries] = *e;
-        N->num_entries++;
-    }
-}
-
-// Función que añade un punto a un cluster
-void addPointInCluster(Cluster* C, Point* p) {
-    if (C->size == 0) {
-        C->points = (Point *)malloc(sizeof(Point));
-        C->points[C->size] = *p;
-        C->size++;
-    }
-    else {
-        C->points = (Point *)realloc(C->points, (C->size + 1) * sizeof(Point));
-        C->points[C->size] = *p;
-        C->size++;
-    }
-}
-
 // Función que retorna un Cluster con los puntos dentrode un arreglo de entradas
 Cluster pointsInEntryArray(EntryArray E) {
-    Point *C_points;
-    Cluster C = {C_points, 0};
+    Cluster C = {(Point *)malloc(E.size * sizeof(Point)), E.size, {0.0, 0.0}, 0.0, NULL};
     for (int i = 0; i < E.size; i++) {
-        Entry e = E.entries[i];
-        Point e_point = e.p;
-        addPointInCluster(&C, &e_point);
+        C.points[i] = E.entries[i].p;
     }
     return C;
 }
 
-// Función que añade una entrada a un arreglo de entradas
-void addEntryInEntryArray(EntryArray* E, Entry* e) {
-    if (E->size == 0) {
-        E->entries = (Entry *)malloc(sizeof(Entry));
-        E->entries[E->size] = *e;
-        E->size++;
-    }
-    else {
-        E->entries = (Entry *)realloc(E->entries, (E->size + 1) * sizeof(Entry));
-        E->entries[E->size] = *e;
-        E->size++;
+// Función que añade una entrada a un arreglo de entradas guardado en el arena scratch
+void addEntryInEntryArray(Arena* scratch, EntryArray* E, Entry* e) {
+    if (isFullArray(E->size)) {
+        int capacity = E->size == 0 ? 1 : 2 * E->size;
+        E->entries = (Entry *)arena_realloc(scratch, E->entries, E->size * sizeof(Entry), capacity * sizeof(Entry));
     }
+    E->entries[E->size] = *e;
+    E->size++;
 }
 
 // Función que verifica si un punto de una entrada está en un cluster
@@ -305,113 +477,190 @@ int isInCLuster(Entry e, Cluster c) {
 }
 
 // Función que retorna un arreglo con las entradas que tengan un punto en el cluster dado
-EntryArray entriesWithPointInCluster(EntryArray E, Cluster c) {
-    Entry *new_E_entries;
-    EntryArray new_E = {new_E_entries, 0};
+EntryArray entriesWithPointInCluster(Arena* scratch, EntryArray E, Cluster c) {
+    EntryArray new_E = {NULL, 0};
     for (int i = 0; i < E.size; i++) {
         Entry e = E.entries[i];
         if (isInCLuster(e,c)) {
-            addEntryInEntryArray(&new_E, &e);
+            addEntryInEntryArray(scratch, &new_E, &e);
         }
     }
     return new_E;
 }
 
 // Función que añade un arreglo de entradas a un arreglo de arreglos de entradas
-void addEntryArrayInEntryArrayArray(EntryArrayArray* EE, EntryArray* E) {
-    if (EE->size == 0) {
-        EE->entries_array = (EntryArray *)malloc(sizeof(EntryArray));
-        EE->entries_array[EE->size] = *E;
-        EE->size++;
-    }
-    else {
-        EE->entries_array = (EntryArray *)realloc(EE->entries_array, (EE->size + 1) * sizeof(EntryArray));
-        EE->entries_array[EE->size] = *E;
-        EE->size++;
+void addEntryArrayInEntryArrayArray(Arena* scratch, EntryArrayArray* EE, EntryArray* E) {
+    if (isFullArray(EE->size)) {
+        int capacity = EE->size == 0 ? 1 : 2 * EE->size;
+        EE->entries_array = (EntryArray *)arena_realloc(scratch, EE->entries_array, EE->size * sizeof(EntryArray), capacity * sizeof(EntryArray));
     }
+    EE->entries_array[EE->size] = *E;
+    EE->size++;
 }
 
-ClusterArray cluster(Cluster C_in) {
-    /*
-    for (size_t i = 0; i < C_in.size; i++){
-        printf("Point %i: (%lf, %lf)\n", i + 1, C_in.points[i].x, C_in.points[i].y);
+// Estructura con el estado del agrupamiento de cluster(): los clusters activos, su medoide primario
+// y su vecino más cercano, para no buscar el par más cercano entre todos los pares en cada iteración
+typedef struct {
+    Cluster *clusters; // cluster in each slot
+    int *nn; // closest active slot to each slot
+    double *nn_dist; // squared distance between the medoids of a slot and its closest slot
+    int *alive; // active slots
+    int *alive_pos; // position of each slot in alive, -1 if the slot is not active
+    int num_alive;
+    Point *alive_medoids; // medoid of the slot in each position of alive, contiguous for squared_distances
+    double *distances; // squared distances from one medoid to alive_medoids
+    int *stale; // slots whose nearest neighbor must be searched again after a merge
+} ClusterEngine;
+
+// Función que calcula en E->distances el cuadrado de la distancia del medoide del slot i a cada cluster activo
+void engine_distances(ClusterEngine *E, int i) {
+    squared_distances(&E->clusters[i].medoid.x, &E->alive_medoids[0].x, POINT_STRIDE, E->num_alive, E->distances);
+}
+
+// Función que busca el cluster activo más cercano al del slot i
+void engine_find_nearest(ClusterEngine *E, int i) {
+    E->nn[i] = -1;
+    E->nn_dist[i] = __DBL_MAX__;
+    engine_distances(E, i);
+    for (int k = 0; k < E->num_alive; k++) {
+        int j = E->alive[k];
+        if (j == i) {
+            continue;
+        }
+        if (E->distances[k] < E->nn_dist[i]) {
+            E->nn_dist[i] = E->distances[k];
+            E->nn[i] = j;
+        }
     }
-    */
-    if (C_in.size < b) {
+}
+
+// Función que saca el slot i de los clusters activos
+void engine_remove(ClusterEngine *E, int i) {
+    int pos = E->alive_pos[i];
+    int last = E->alive[--E->num_alive];
+    E->alive[pos] = last;
+    E->alive_medoids[pos] = E->alive_medoids[E->num_alive];
+    E->alive_pos[last] = pos;
+    E->alive_pos[i] = -1;
+}
+
+/* agrupa los puntos de source, que solo se leen una vez y en orden en el paso 2 */
+ClusterArray cluster_source(PointSource *source) {
+    if (source->size < b) {
         printf("El tamaño del set de puntos es menor a b.\n");
         exit(1);
     }
     /* 1. */
-    printf("paso 1 cluster\n");
-    Cluster *C_out_clusters;
-    ClusterArray C_out = {C_out_clusters, 0};
-    Cluster *C_clusters;
-    ClusterArray C = {C_clusters, 0};
+    ClusterArray C_out = {NULL, 0};
+    ClusterEngine E;
+    int n = source->size;
+    E.clusters = (Cluster *)malloc(n * sizeof(Cluster));
+    E.nn = (int *)malloc(n * sizeof(int));
+    E.nn_dist = (double *)malloc(n * sizeof(double));
+    E.alive = (int *)malloc(n * sizeof(int));
+    E.alive_pos = (int *)malloc(n * sizeof(int));
+    E.alive_medoids = (Point *)malloc(n * sizeof(Point));
+    E.distances = (double *)malloc(n * sizeof(double));
+    E.stale = (int *)malloc(n * sizeof(int));
+    E.num_alive = n;
     /* 2. */
-    printf("paso 2 cluster\n");
-    for (int i = 0; i < C_in.size; i++) {
-        /* añadir {p} a C */
-        Point p = C_in.points[i];
-        Point *pp = (Point *)malloc(sizeof(Point));
-        pp[0] = p;
-        Cluster C_p = {pp, 1}; // {p}
-        addCluster(&C, &C_p);
+    int chunk_size;
+    for (int first = 0; first < n; first += chunk_size) {
+        const Point *chunk = point_source_chunk(source, first, &chunk_size);
+        for (int k = 0; k < chunk_size; k++) {
+            /* añadir {p} a C */
+            int i = first + k;
+            Point p = chunk[k];
+            Point *pp = (Point *)malloc(sizeof(Point));
+            pp[0] = p;
+            double *ecc = (double *)calloc(1, sizeof(double));
+            Cluster C_p = {pp, 1, p, 0.0, ecc}; // {p}
+            E.clusters[i] = C_p;
+            E.alive[i] = i;
+            E.alive_pos[i] = i;
+            E.alive_medoids[i] = p;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        engine_find_nearest(&E, i);
     }
     /* 3. */
-    printf("paso 3 cluster\n");
-    /* -------------------------------------------------------ClusterArray C pareciera estar guardando bien los {p}-------------------------------------------------
-    for (size_t i = 0; i < C.size; i++){
-        printf("Point %i: (%lf, %lf)\n", i + 1, C.clusters[i].points[0].x, C.clusters[i].points[0].y);
-    }
-    */
-    while (C.size > 1) { /*-------------------------------pareciera estar bien ahora---------------------------*/
-        printf("%d\n", C.size);
-        int* pos_C_mas_cercanos = closest_pair(&C); // muy ineficiente
-        int pos_c1, pos_c2;
-        if (C.clusters[pos_C_mas_cercanos[0]].size >= C.clusters[pos_C_mas_cercanos[1]].size){
-            pos_c1 = pos_C_mas_cercanos[0];
-            pos_c2 = pos_C_mas_cercanos[1];
+    while (E.num_alive > 1) {
+        /* el par más cercano es el de menor distancia a su vecino más cercano */
+        int closest = E.alive[0];
+        for (int k = 1; k < E.num_alive; k++) {
+            int i = E.alive[k];
+            if (E.nn_dist[i] < E.nn_dist[closest]) {
+                closest = i;
+            }
         }
-        else {
-            pos_c1 = pos_C_mas_cercanos[1];
-            pos_c2 = pos_C_mas_cercanos[0];
+        int pos_c1 = closest;
+        int pos_c2 = E.nn[closest];
+        if (E.clusters[pos_c1].size < E.clusters[pos_c2].size) {
+            pos_c1 = E.nn[closest];
+            pos_c2 = closest;
         }
-        Cluster c1, c2;
-        c1 = C.clusters[pos_c1];
-        c2 = C.clusters[pos_c2];
+        Cluster c1 = E.clusters[pos_c1];
+        Cluster c2 = E.clusters[pos_c2];
         if ((c1.size + c2.size) <= B) {
-            removeCluster(&C, pos_c1);
-            removeCluster(&C, pos_c2);
-            Cluster c_union = merge_clusters(c1,c2);
-            addCluster(&C, &c_union);
+            /* la unión queda en el slot de c1 */
+            Cluster c_union = merge_clusters(c1, c2);
+            free_cluster(&c1);
+            free_cluster(&c2);
+            E.clusters[pos_c1] = c_union;
+            E.alive_medoids[E.alive_pos[pos_c1]] = c_union.medoid;
+            engine_remove(&E, pos_c2);
+            /* los clusters que no tenían como vecino a c1 ni a c2 solo se comparan con la unión */
+            int num_stale = 0;
+            engine_distances(&E, pos_c1);
+            for (int k = 0; k < E.num_alive; k++) {
+                int i = E.alive[k];
+                if (i == pos_c1) {
+                    continue;
+                }
+                if (E.nn[i] == pos_c1 || E.nn[i] == pos_c2) {
+                    E.stale[num_stale++] = i;
+                }
+                else if (E.distances[k] < E.nn_dist[i]) {
+                    E.nn_dist[i] = E.distances[k];
+                    E.nn[i] = pos_c1;
+                }
+            }
+            for (int k = 0; k < num_stale; k++) {
+                engine_find_nearest(&E, E.stale[k]);
+            }
+            engine_find_nearest(&E, pos_c1);
         }
         else {
-            removeCluster(&C, pos_c1);
+            engine_remove(&E, pos_c1);
             addCluster(&C_out, &c1);
+            for (int k = 0; k < E.num_alive; k++) {
+                int i = E.alive[k];
+                if (E.nn[i] == pos_c1) {
+                    engine_find_nearest(&E, i);
+                }
+            }
         }
     }
-    /*
-    printf("%d\n", C.size);
-    printf("%d\n", C_out.size);
-    */
     /* 4. */
-    printf("paso 4 cluster\n");
-    Cluster c = C.clusters[0];
+    Cluster c = E.clusters[E.alive[0]];
+    free(E.clusters);
+    free(E.nn);
+    free(E.nn_dist);
+    free(E.alive);
+    free(E.alive_pos);
+    free(E.alive_medoids);
+    free(E.distances);
+    free(E.stale);
     /* 5. */
-    printf("paso 5 cluster\n");
-    Cluster c_prima;
+    Cluster c_prima = {NULL, 0, {0.0, 0.0}, 0.0, NULL};
     int pos_c_prima;
     if (C_out.size > 0) {
         pos_c_prima = closest_neighbor(c, C_out); 
         c_prima = C_out.clusters[pos_c_prima];
         removeCluster(&C_out, pos_c_prima);
     }
-    else {
-        Point *c_prima_points;
-        Cluster c_prima = {c_prima_points, 0};
-    }
     /* 6. */
-    printf("paso 6 cluster\n");
     if ((c.size + c_prima.size) <= B) {
         /* añadimos (c U c_prima) a C_out*/
         Cluster c_union_prima = merge_clusters(c, c_prima);
@@ -424,122 +673,128 @@ ClusterArray cluster(Cluster C_in) {
         Cluster c2 = minMaxCluster.clusters[1];
         addCluster(&C_out, &c1);
         addCluster(&C_out, &c2);
+        free_cluster(&c_union_prima);
+        free(minMaxCluster.clusters);
     }
+    free_cluster(&c);
+    free_cluster(&c_prima);
     /* 7. */
-    printf("paso 7 cluster\n");
     return C_out;
 }
 
+ClusterArray cluster(Cluster C_in) {
+    PointSource source = memory_point_source(C_in.points, C_in.size);
+    return cluster_source(&source);
+}
+
 Entry OutputHoja(Cluster C_in) {
     /* 1. */
-    printf("paso 1 hoja\n");
+    int had_cache = C_in.ecc != NULL;
     Point g = primary_medoid(&C_in);
     double r = 0;
-    Entry *C_entries;
-    Node C = {C_entries, 0};
+    Node *C = create_node_with_capacity(C_in.size);
     /* 2. */
-    printf("paso 2 hoja\n");
     for (int i = 0; i < C_in.size; i++) {
         Point p = C_in.points[i];
-        Entry new_entry = {p, 0.0, NULL};
-        addEntryInNode(&C, &new_entry);
-        r = max(r, euclidean_distance(g,p));
+        Entry new_entry = {p, 0.0, NULL, euclidean_distance(g,p), 1};
+        insertEntry(C, new_entry);
+        r = max(r, new_entry.pd);
+    }
+    if (!had_cache) {
+        free(C_in.ecc);
     }
     /* 3. */
-    printf("paso 3 hoja\n");
-    Node *a = &C;
+    Node *a = C;
     /* 4. */
-    printf("paso 4 hoja\n");
-    Entry out = {g, r, a};
+    Entry out = {g, r, a, 0.0, C_in.size};
     return out;
 }
 
 Entry OutputInterno(EntryArray C_mra) {
     // printf("%d\n", C_mra.size);
     /* 1. */
-    printf("paso 1 interno\n");
     Cluster C_in = pointsInEntryArray(C_mra);
     Point G = primary_medoid(&C_in);
     double R = 0.0;
-    Entry *C_entries;
-    Node C = {C_entries, 0};
+    Node *C = create_node_with_capacity(C_mra.size);
     /* 2. */
-    printf("paso 2 interno\n");
     for (int i = 0; i < C_mra.size; i++) {
         Entry new_entry = C_mra.entries[i];
-        addEntryInNode(&C, &new_entry);
-        R = max(R, euclidean_distance(G,new_entry.p) + new_entry.cr);
+        new_entry.pd = euclidean_distance(G,new_entry.p);
+        insertEntry(C, new_entry);
+        R = max(R, new_entry.pd + new_entry.cr);
     }
+    free_cluster(&C_in);
     /* 3. */
-    printf("paso 3 interno\n");
-    Node *A = &C;
+    Node *A = C;
     /* 4. */
-    printf("paso 4 interno\n");
-    Entry out = {G, R, A};
+    Entry out = {G, R, A, 0.0, subtree_count(A)};
     return out;
 }
 
-Node *sextonSwinbank(Point* P, int P_size) {
-    Cluster C_in = {P, P_size};
+/* construye el árbol de los puntos de source (por ejemplo un archivo de puntos), que solo se leen una vez en orden */
+Node *sextonSwinbankFromSource(PointSource *source) {
     /* 1. */
-    printf("paso 1 ss\n");
-    if (C_in.size <= B) {
+    if (source->size <= B) {
+        Cluster C_in = {(Point *)malloc(source->size * sizeof(Point)), source->size, {0.0, 0.0}, 0.0, NULL};
+        int chunk_size;
+        for (int first = 0; first < source->size; first += chunk_size) {
+            const Point *chunk = point_source_chunk(source, first, &chunk_size);
+            memcpy(C_in.points + first, chunk, chunk_size * sizeof(Point));
+        }
         Entry res = OutputHoja(C_in);
+        free(C_in.points);
         return res.a;
     }
+    /* los arreglos de entradas de cada nivel se guardan en un arena, los nodos se copian con create_node */
+    Arena *scratch = create_arena(ARENA_BLOCK_SIZE, 0);
     /* 2. */
-    printf("paso 2 ss\n");
-    ClusterArray C_out = cluster(C_in);
-    // printf("%d\n", C_out.size);
-    /*
-    for (int i=0; i < C_out.size; i++) {
-        printf("%d\n", C_out.clusters[2].size);
-    }
-    */
-    Entry *C_entries;
-    EntryArray C = {C_entries, 0};
+    ClusterArray C_out = cluster_source(source);
+    EntryArray C = {NULL, 0};
     /* 3. */
-    printf("paso 3 ss\n");
     for (int i = 0; i < C_out.size; i++) {
         Cluster c = C_out.clusters[i];
         Entry hoja_c = OutputHoja(c);
-        addEntryInEntryArray(&C, &hoja_c);
+        addEntryInEntryArray(scratch, &C, &hoja_c);
+        free_cluster(&c);
     }
+    free(C_out.clusters);
 
     /* 4. */
-    printf("paso 4 ss\n");
     while (C.size > B) {
         /* 4.1 */
-        printf("paso 4.1 ss\n");
         Cluster C_in = pointsInEntryArray(C);
         ClusterArray C_out = cluster(C_in);
-        EntryArray *C_mra_array_entries;
-        EntryArrayArray C_mra = {C_mra_array_entries, 0};
+        EntryArrayArray C_mra = {NULL, 0};
         /* 4.2 */
-        printf("paso 4.2 ss\n");
         for (int i = 0; i < C_out.size; i++) {
             Cluster c = C_out.clusters[i];
-            EntryArray s = entriesWithPointInCluster(C, c);
+            EntryArray s = entriesWithPointInCluster(scratch, C, c);
             if (s.size != 0) {
-                addEntryArrayInEntryArrayArray(&C_mra, &s);
+                addEntryArrayInEntryArrayArray(scratch, &C_mra, &s);
             }
+            free_cluster(&c);
         }
+        free(C_out.clusters);
+        free_cluster(&C_in);
         /* 4.3 */
-        printf("paso 4.3 ss\n");
-        Entry *C_entries;
-        EntryArray C = {C_entries, 0};
+        C.entries = NULL;
+        C.size = 0;
         /* 4.4 */
-        printf("paso 4.4 ss\n");
         for (int i = 0; i < C_mra.size; i++) {
             EntryArray s = C_mra.entries_array[i];
             Entry interno_s = OutputInterno(s);
-            addEntryInEntryArray(&C, &interno_s);
+            addEntryInEntryArray(scratch, &C, &interno_s);
         }
     }
     /* 5. */
-    printf("paso 5 ss\n");
     Entry res = OutputInterno(C);
+    destroy_arena(scratch);
     /* 6. */
-    printf("paso 6 ss\n");
     return res.a;
+}
+
+Node *sextonSwinbank(Point* P, int P_size) {
+    PointSource source = memory_point_source(P, P_size);
+    return sextonSwinbankFromSource(&source);
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+#ifndef STATS_C
+#define STATS_C
+
+#include "mtree.c"
+
+// Cantidad de intervalos de los histogramas de llenado de nodos y de radios cobertores
+#define STATS_FILL_BUCKETS 10
+#define STATS_RADIUS_BUCKETS 10
+
+typedef struct levelstats LevelStats;
+typedef struct treestats TreeStats;
+typedef struct statswalk StatsWalk;
+
+// Estructura con las estadísticas de los nodos de un nivel del árbol, donde la raíz es el nivel 0
+struct levelstats {
+    int nodes;
+    int leaves;
+    long entries;
+    int min_entries, max_entries;
+    int underfull; // nodes other than the root with fewer than b entries
+    int fill_histogram[STATS_FILL_BUCKETS]; // bucket i counts nodes with i * B / 10 <= entries < (i + 1) * B / 10, full nodes go in the last one
+    size_t memory_bytes;
+
+    // covering radii of the entries of this level that point to a child
+    long radii;
+    double min_radius, max_radius, mean_radius;
+    double radius_p50, radius_p90;
+    int radius_histogram[STATS_RADIUS_BUCKETS]; // equal intervals of [0, max_radius]
+
+    // pairs of balls of entries of the same node
+    long sibling_pairs;
+    long overlapping_pairs;
+    double mean_overlap; // area shared by the two balls over the area of the smaller one, averaged over every pair
+};
+
+// Estructura con las estadísticas de un árbol calculadas por mtree_stats
+struct treestats {
+    int height;
+    int balanced; // 1 if every leaf is in the last level
+    int nodes;
+    int leaves;
+    long points;
+    int node_capacity; // B when the stats were taken
+    size_t memory_bytes; // nodes and their entries arrays at full capacity
+    size_t used_bytes; // nodes and the entries they use
+    long sibling_pairs;
+    long overlapping_pairs;
+    double mean_overlap;
+    LevelStats* levels; // height levels
+};
+
+// Estructura con los radios de cada nivel que junta el recorrido de mtree_stats, para calcular sus percentiles al final
+struct statswalk {
+    TreeStats* stats;
+    double** radii;
+    long* capacity;
+};
+
+// Función que retorna el área de la intersección de dos círculos de radios r1 y r2 con centros a distancia d,
+// dividida por el área del más pequeño. Un círculo de radio 0 cuenta como completamente cubierto si está dentro del otro
+double ball_overlap(double r1, double r2, double d) {
+    double r_min = fmin(r1, r2);
+    double r_max = fmax(r1, r2);
+    if (d >= r1 + r2 && !(d == 0.0 && r_min == 0.0))
+        return 0.0;
+    if (d <= r_max - r_min)
+        return 1.0;
+
+    double a1 = (d * d + r1 * r1 - r2 * r2) / (2 * d * r1);
+    double a2 = (d * d + r2 * r2 - r1 * r1) / (2 * d * r2);
+    double lens = r1 * r1 * acos(fmax(-1.0, fmin(1.0, a1))) + r2 * r2 * acos(fmax(-1.0, fmin(1.0, a2))) -
+                  0.5 * sqrt(fmax(0.0, (-d + r1 + r2) * (d + r1 - r2) * (d - r1 + r2) * (d + r1 + r2)));
+    return fmin(1.0, lens / (M_PI * r_min * r_min));
+}
+
+// Función que agrega un nivel vacío al recorrido walk
+void add_stats_level(StatsWalk* walk) {
+    TreeStats* stats = walk->stats;
+    int level = stats->height++;
+    stats->levels = (LevelStats*)realloc(stats->levels, stats->height * sizeof(LevelStats));
+    walk->radii = (double**)realloc(walk->radii, stats->height * sizeof(double*));
+    walk->capacity = (long*)realloc(walk->capacity, stats->height * sizeof(long));
+
+    LevelStats* l = &stats->levels[level];
+    memset(l, 0, sizeof(LevelStats));
+    l->min_entries = INT_MAX;
+    l->min_radius = INFINITY;
+    walk->radii[level] = NULL;
+    walk->capacity[level] = 0;
+}
+
+// Función que suma al recorrido walk el nodo node, que está en el nivel level, y a sus descendientes
+void collect_stats(Node* node, int level, StatsWalk* walk) {
+    TreeStats* stats = walk->stats;
+    if (level == stats->height)
+        add_stats_level(walk);
+    LevelStats* l = &stats->levels[level];
+    int num_entries = node->num_entries;
+
+    l->nodes++;
+    l->entries += num_entries;
+    l->min_entries = num_entries < l->min_entries ? num_entries : l->min_entries;
+    l->max_entries = num_entries > l->max_entries ? num_entries : l->max_entries;
+    if (level > 0 && num_entries < b)
+        l->underfull++;
+    int bucket = num_entries * STATS_FILL_BUCKETS / B;
+    l->fill_histogram[bucket < STATS_FILL_BUCKETS ? bucket : STATS_FILL_BUCKETS - 1]++;
+    l->memory_bytes += sizeof(Node) + node->capacity * sizeof(Entry);
+    stats->used_bytes += sizeof(Node) + num_entries * sizeof(Entry);
+
+    if (is_leaf(node)) {
+        l->leaves++;
+        stats->points += num_entries;
+        return;
+    }
+
+    // Every pair of siblings, which is at most B^2 / 2 distances per node
+    for (int i = 0; i < num_entries; i++) {
+        Entry* e = &node->entries[i];
+        for (int j = i + 1; j < num_entries; j++) {
+            double overlap = ball_overlap(e->cr, node->entries[j].cr, euclidean_distance(e->p, node->entries[j].p));
+            l->sibling_pairs++;
+            l->overlapping_pairs += overlap > 0.0;
+            l->mean_overlap += overlap;
+        }
+
+        if (l->radii == walk->capacity[level]) {
+            walk->capacity[level] = walk->capacity[level] == 0 ? 64 : 2 * walk->capacity[level];
+            walk->radii[level] = (double*)realloc(walk->radii[level], walk->capacity[level] * sizeof(double));
+        }
+        walk->radii[level][l->radii++] = e->cr;
+    }
+
+    for (int i = 0; i < num_entries; i++) {
+        if (node->entries[i].a != NULL) {
+            collect_stats(node->entries[i].a, level + 1, walk);
+            l = &stats->levels[level]; // adding a level moves the array
+        }
+    }
+}
+
+// Función que compara dos radios, usada por qsort
+int compare_radii(const void* a, const void* b2) {
+    double x = *(const double*)a;
+    double y = *(const double*)b2;
+    return (x > y) - (x < y);
+}
+
+// Función que calcula las estadísticas del árbol root en un solo recorrido: altura, nodos por nivel, histogramas de llenado
+// respecto a b y B, distribución de los radios cobertores, cuánto se superponen las bolas de entradas hermanas y memoria usada.
+// Se liberan con free_tree_stats
+TreeStats* mtree_stats(Node* root) {
+    TreeStats* stats = (TreeStats*)calloc(1, sizeof(TreeStats));
+    stats->node_capacity = B;
+    StatsWalk walk = {stats, NULL, NULL};
+    collect_stats(root, 0, &walk);
+
+    stats->balanced = 1;
+    for (int level = 0; level < stats->height; level++) {
+        LevelStats* l = &stats->levels[level];
+        stats->nodes += l->nodes;
+        stats->leaves += l->leaves;
+        stats->memory_bytes += l->memory_bytes;
+        if (l->leaves > 0 && level < stats->height - 1)
+            stats->balanced = 0;
+
+        stats->sibling_pairs += l->sibling_pairs;
+        stats->overlapping_pairs += l->overlapping_pairs;
+        stats->mean_overlap += l->mean_overlap;
+        if (l->sibling_pairs > 0)
+            l->mean_overlap /= l->sibling_pairs;
+
+        double* radii = walk.radii[level];
+        if (l->radii == 0) {
+            l->min_radius = 0.0;
+            continue;
+        }
+        qsort(radii, l->radii, sizeof(double), compare_radii);
+        l->min_radius = radii[0];
+        l->max_radius = radii[l->radii - 1];
+        l->radius_p50 = radii[(l->radii - 1) / 2];
+        l->radius_p90 = radii[(l->radii - 1) * 9 / 10];
+        for (long i = 0; i < l->radii; i++) {
+            l->mean_radius += radii[i];
+            int bucket = l->max_radius > 0.0 ? (int)(radii[i] / l->max_radius * STATS_RADIUS_BUCKETS) : 0;
+            l->radius_histogram[bucket < STATS_RADIUS_BUCKETS ? bucket : STATS_RADIUS_BUCKETS - 1]++;
+        }
+        l->mean_radius /= l->radii;
+    }
+    if (stats->sibling_pairs > 0)
+        stats->mean_overlap /= stats->sibling_pairs;
+
+    for (int level = 0; level < stats->height; level++)
+        free(walk.radii[level]);
+    free(walk.radii);
+    free(walk.capacity);
+    return stats;
+}
+
+// Función que libera las estadísticas retornadas por mtree_stats
+void free_tree_stats(TreeStats* stats) {
+    free(stats->levels);
+    free(stats);
+}
+
+// Función que muestra las estadísticas de un árbol, un nivel por línea
+void print_tree_stats(TreeStats* stats) {
+    printf("Height %i (%s), %i nodes, %i leaves, %ld points, B = %i, b = %i\n", stats->height,
+           stats->balanced ? "balanced" : "unbalanced", stats->nodes, stats->leaves, stats->points,
+           stats->node_capacity, stats->node_capacity / 2);
+    printf("Memory: %zu bytes, %zu in use (%.1f%%)\n", stats->memory_bytes, stats->used_bytes,
+           stats->memory_bytes > 0 ? 100.0 * stats->used_bytes / stats->memory_bytes : 0.0);
+    printf("Sibling balls: %ld pairs, %.1f%% overlap, mean shared area %.3f\n", stats->sibling_pairs,
+           stats->sibling_pairs > 0 ? 100.0 * stats->overlapping_pairs / stats->sibling_pairs : 0.0, stats->mean_overlap);
+
+    for (int level = 0; level < stats->height; level++) {
+        LevelStats* l = &stats->levels[level];
+        printf("  Level %i: %i nodes (%i leaves), entries %i-%i, mean fill %.2f of B, %i under b, fill histogram [", level,
+               l->nodes, l->leaves, l->min_entries, l->max_entries, (double)l->entries / l->nodes / stats->node_capacity, l->underfull);
+        for (int i = 0; i < STATS_FILL_BUCKETS; i++)
+            printf(i == 0 ? "%i" : " %i", l->fill_histogram[i]);
+        printf("]\n");
+
+        if (l->radii == 0)
+            continue;
+        printf("    Radii: min %.5f, p50 %.5f, p90 %.5f, max %.5f, mean %.5f, histogram [", l->min_radius, l->radius_p50,
+               l->radius_p90, l->max_radius, l->mean_radius);
+        for (int i = 0; i < STATS_RADIUS_BUCKETS; i++)
+            printf(i == 0 ? "%i" : " %i", l->radius_histogram[i]);
+        printf("]\n");
+        printf("    Siblings: %ld pairs, %.1f%% overlap, mean shared area %.3f\n", l->sibling_pairs,
+               l->sibling_pairs > 0 ? 100.0 * l->overlapping_pairs / l->sibling_pairs : 0.0, l->mean_overlap);
+    }
+}
+
+#endif
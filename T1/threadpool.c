@@ -0,0 +1,282 @@
+#ifndef THREADPOOL_C
+#define THREADPOOL_C
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+typedef struct threadpool ThreadPool;
+typedef void (*PoolJob)(void* ctx, int worker);
+
+// Estructura que representa un grupo de hilos que ejecutan el mismo trabajo en paralelo.
+// El hilo que llama a thread_pool_run participa como el trabajador 0
+struct threadpool {
+    int num_threads;
+    pthread_t* threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    PoolJob job;
+    void* ctx;
+    long generation; // increases every time a new job is published
+    int running; // workers that have not finished the current job
+    int stop;
+};
+
+// Estructura con los datos que recibe cada hilo del grupo
+typedef struct {
+    ThreadPool* pool;
+    int worker;
+} PoolWorker;
+
+// Función que retorna la cantidad de núcleos disponibles
+int available_cores() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+// Función que ejecuta cada hilo del grupo: espera un trabajo nuevo, lo ejecuta y avisa que terminó
+void* pool_worker_loop(void* arg) {
+    PoolWorker* self = (PoolWorker*)arg;
+    ThreadPool* pool = self->pool;
+    long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (!pool->stop && pool->generation == seen)
+            pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->stop)
+            break;
+        seen = pool->generation;
+        PoolJob job = pool->job;
+        void* ctx = pool->ctx;
+        pthread_mutex_unlock(&pool->lock);
+
+        job(ctx, self->worker);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(self);
+    return NULL;
+}
+
+// Función que crea un grupo de num_threads hilos (contando al que llama)
+ThreadPool* create_thread_pool(int num_threads) {
+    if (num_threads < 1)
+        num_threads = 1;
+
+    ThreadPool* pool = (ThreadPool*)malloc(sizeof(ThreadPool));
+    pool->num_threads = num_threads;
+    pool->threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->job = NULL;
+    pool->ctx = NULL;
+    pool->generation = 0;
+    pool->running = 0;
+    pool->stop = 0;
+
+    for (int i = 1; i < num_threads; i++) {
+        PoolWorker* worker = (PoolWorker*)malloc(sizeof(PoolWorker));
+        worker->pool = pool;
+        worker->worker = i;
+        pthread_create(&pool->threads[i], NULL, pool_worker_loop, worker);
+    }
+    return pool;
+}
+
+// Función que ejecuta job(ctx, worker) en todos los hilos del grupo y retorna cuando todos terminaron
+void thread_pool_run(ThreadPool* pool, PoolJob job, void* ctx) {
+    pthread_mutex_lock(&pool->lock);
+    pool->job = job;
+    pool->ctx = ctx;
+    pool->running = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    job(ctx, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Función que detiene los hilos del grupo y libera su memoria
+void destroy_thread_pool(ThreadPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->num_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool);
+}
+
+typedef struct task Task;
+typedef struct taskdeque TaskDeque;
+typedef struct taskscheduler TaskScheduler;
+typedef void (*TaskFn)(void* arg);
+
+// Estructura que representa una tarea pendiente. pending es el contador de tareas que espera quien la creó
+struct task {
+    TaskFn fn;
+    void* arg;
+    atomic_int* pending;
+};
+
+// Estructura que representa la cola de tareas de un hilo. El dueño agrega y saca por tail; los demás hilos roban por head
+struct taskdeque {
+    pthread_mutex_t lock;
+    Task* tasks;
+    int head;
+    int tail;
+    int capacity;
+};
+
+// Estructura que representa un planificador de tareas con robo de trabajo sobre los hilos de un ThreadPool
+struct taskscheduler {
+    ThreadPool* pool;
+    TaskDeque* deques;
+    atomic_int finished;
+    TaskFn root;
+    void* root_arg;
+};
+
+// Hilo del grupo que ejecuta el código actual, asignado al empezar cada trabajo
+_Thread_local int current_worker = 0;
+
+// Función que agrega la tarea task al final de la cola deque
+void deque_push(TaskDeque* deque, Task task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail == deque->capacity) {
+        if (deque->head > 0) {
+            // reuse the slots already taken by thieves
+            memmove(deque->tasks, deque->tasks + deque->head, (deque->tail - deque->head) * sizeof(Task));
+            deque->tail -= deque->head;
+            deque->head = 0;
+        }
+        else {
+            deque->capacity = deque->capacity == 0 ? 64 : 2 * deque->capacity;
+            deque->tasks = (Task*)realloc(deque->tasks, deque->capacity * sizeof(Task));
+        }
+    }
+    deque->tasks[deque->tail++] = task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+// Función que saca una tarea de la cola deque, la más nueva si from_tail es 1 o la más antigua si es 0. Retorna 0 si estaba vacía
+int deque_take(TaskDeque* deque, Task* task, int from_tail) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        *task = from_tail ? deque->tasks[--deque->tail] : deque->tasks[deque->head++];
+        if (deque->head == deque->tail) {
+            deque->head = 0;
+            deque->tail = 0;
+        }
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Función que ejecuta una tarea de la cola propia o, si está vacía, una robada a otro hilo. Retorna 0 si no encontró tareas
+int run_one_task(TaskScheduler* scheduler) {
+    int num_threads = scheduler->pool->num_threads;
+    int worker = current_worker;
+    Task task;
+
+    int found = deque_take(&scheduler->deques[worker], &task, 1);
+    for (int i = 1; !found && i < num_threads; i++)
+        found = deque_take(&scheduler->deques[(worker + i) % num_threads], &task, 0);
+    if (!found)
+        return 0;
+
+    task.fn(task.arg);
+    atomic_fetch_sub(task.pending, 1);
+    return 1;
+}
+
+// Función que crea la tarea fn(arg) en la cola del hilo actual, sumándola al contador pending
+void spawn_task(TaskScheduler* scheduler, TaskFn fn, void* arg, atomic_int* pending) {
+    Task task = {fn, arg, pending};
+    atomic_fetch_add(pending, 1);
+    deque_push(&scheduler->deques[current_worker], task);
+}
+
+// Función que espera a que terminen las tareas contadas en pending, ejecutando tareas pendientes mientras tanto
+void wait_tasks(TaskScheduler* scheduler, atomic_int* pending) {
+    while (atomic_load(pending) > 0) {
+        if (!run_one_task(scheduler))
+            sched_yield();
+    }
+}
+
+// Función que ejecuta cada hilo: el hilo 0 ejecuta la tarea raíz y los demás roban tareas hasta que esta termine
+void scheduler_job(void* ctx, int worker) {
+    TaskScheduler* scheduler = (TaskScheduler*)ctx;
+    current_worker = worker;
+
+    if (worker == 0) {
+        scheduler->root(scheduler->root_arg);
+        atomic_store(&scheduler->finished, 1);
+    }
+    else {
+        while (!atomic_load(&scheduler->finished)) {
+            if (!run_one_task(scheduler))
+                sched_yield();
+        }
+    }
+}
+
+// Función que crea un planificador de tareas con robo de trabajo sobre los hilos de pool
+TaskScheduler* create_task_scheduler(ThreadPool* pool) {
+    TaskScheduler* scheduler = (TaskScheduler*)malloc(sizeof(TaskScheduler));
+    scheduler->pool = pool;
+    scheduler->deques = (TaskDeque*)malloc(pool->num_threads * sizeof(TaskDeque));
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_mutex_init(&scheduler->deques[i].lock, NULL);
+        scheduler->deques[i].tasks = NULL;
+        scheduler->deques[i].head = 0;
+        scheduler->deques[i].tail = 0;
+        scheduler->deques[i].capacity = 0;
+    }
+    atomic_init(&scheduler->finished, 0);
+    return scheduler;
+}
+
+// Función que ejecuta root(root_arg) en el hilo 0 de scheduler mientras los demás hilos ejecutan las tareas que se vayan creando
+void run_task_scheduler(TaskScheduler* scheduler, TaskFn root, void* root_arg) {
+    scheduler->root = root;
+    scheduler->root_arg = root_arg;
+    atomic_store(&scheduler->finished, 0);
+    thread_pool_run(scheduler->pool, scheduler_job, scheduler);
+}
+
+// Función que libera las colas del planificador
+void destroy_task_scheduler(TaskScheduler* scheduler) {
+    for (int i = 0; i < scheduler->pool->num_threads; i++) {
+        pthread_mutex_destroy(&scheduler->deques[i].lock);
+        free(scheduler->deques[i].tasks);
+    }
+    free(scheduler->deques);
+    free(scheduler);
+}
+
+#endif